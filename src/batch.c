@@ -0,0 +1,838 @@
+/*
+ * Marvin - an UCI/XBoard compatible chess engine
+ * Copyright (C) 2015 Martin Danielsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+
+#include "batch.h"
+#include "chess.h"
+#include "board.h"
+#include "bitboard.h"
+#include "fen.h"
+#include "search.h"
+#include "smp.h"
+#include "thread.h"
+#include "timectl.h"
+#include "utils.h"
+
+/* The maximum length of a line in an input file */
+#define BATCH_MAX_LINE_LENGTH 1024
+
+/*
+ * The number of items per job that are kept in memory. Results are
+ * written in input order so a job that finishes early can continue
+ * with later items while waiting for a slow item to finish.
+ */
+#define BATCH_SLOTS_PER_JOB 32
+
+/* The maximum length of a line in an annotated game */
+#define BATCH_PGN_LINE_LENGTH 79
+
+/*
+ * The maximum number of plies of a game that are annotated. Room is
+ * left in the position history for the search.
+ */
+#define BATCH_MAX_GAME_LENGTH (MAX_HISTORY_SIZE-MAX_PLY-1)
+
+/* An item to analyze, a position or a game */
+struct batch_item {
+    /* The input read from the file */
+    char *input;
+    /* The formatted result, NULL if the input could not be analyzed */
+    char *result;
+    /* Flag indicating if the analysis of the item is finished */
+    atomic_bool done;
+};
+
+/* Data for a job running searches in its own thread */
+struct batch_job {
+    thread_t thread;
+    struct search_worker *worker;
+    struct gamestate *state;
+    /* The number of positions analyzed by the job */
+    uint64_t npositions;
+};
+
+/*
+ * Growable string used for building annotated games. If an allocation
+ * fails the buffer is freed and set to NULL, and all following appends
+ * are ignored.
+ */
+struct text {
+    char *buffer;
+    int  length;
+    int  size;
+    int  line_length;
+    bool failed;
+};
+
+/* Function for reading the next item, returns NULL at the end of the file */
+typedef char* (*read_func_t)(FILE *fp);
+
+/* Function for analyzing an item, returns NULL if the item is invalid */
+typedef char* (*analyze_func_t)(struct batch_job *job, char *input);
+
+/* Ring buffer with the items currently in memory */
+static struct batch_item *items = NULL;
+static int nslots = 0;
+
+/* The number of items read so far and if all items have been read */
+static atomic_int nitems;
+static atomic_bool end_of_input;
+
+/* The index of the next item to analyze */
+static atomic_int next_item;
+
+/* The function used for analyzing items */
+static analyze_func_t analyze_item = NULL;
+
+/* Search limits used for all positions */
+static int search_depth = 0;
+static uint64_t search_nodes = 0ULL;
+
+/* Event signaled every time the analysis of an item is finished */
+static event_t done_event;
+
+/* Line read from a PGN file that belongs to the next game */
+static char pending_line[BATCH_MAX_LINE_LENGTH];
+static bool has_pending_line = false;
+
+static void text_append(struct text *text, char *str)
+{
+    char *buffer;
+    int  len;
+
+    if (text->failed) {
+        return;
+    }
+
+    len = strlen(str);
+    if ((text->length+len+1) > text->size) {
+        buffer = realloc(text->buffer, 2*(text->length+len+1));
+        if (buffer == NULL) {
+            free(text->buffer);
+            text->buffer = NULL;
+            text->failed = true;
+            return;
+        }
+        text->buffer = buffer;
+        text->size = 2*(text->length+len+1);
+    }
+    strcpy(&text->buffer[text->length], str);
+    text->length += len;
+
+    if (strchr(str, '\n') != NULL) {
+        text->line_length = strlen(strrchr(str, '\n')+1);
+    } else {
+        text->line_length += len;
+    }
+}
+
+static void text_append_token(struct text *text, char *token)
+{
+    if (text->line_length > 0) {
+        if ((text->line_length+1+(int)strlen(token)) >
+                                                BATCH_PGN_LINE_LENGTH) {
+            text_append(text, "\n");
+        } else {
+            text_append(text, " ");
+        }
+    }
+    text_append(text, token);
+}
+
+static void strip_line(char *line)
+{
+    int len;
+
+    len = strlen(line);
+    while ((len > 0) && ((line[len-1] == '\n') || (line[len-1] == '\r') ||
+                         (line[len-1] == ' ') || (line[len-1] == '\t'))) {
+        line[--len] = '\0';
+    }
+}
+
+/*
+ * Setup a position from a FEN string. Since the input can be anything
+ * positions that the search can't handle, like positions without
+ * exactly one king per side or where the side to move can capture the
+ * opponent king, are rejected as well.
+ */
+static bool setup_position(struct position *pos, char *fen)
+{
+    if (!board_setup_from_fen(pos, fen)) {
+        return false;
+    }
+    if ((BITCOUNT(pos->bb_pieces[WHITE_KING]) != 1) ||
+        (BITCOUNT(pos->bb_pieces[BLACK_KING]) != 1)) {
+        return false;
+    }
+    return !board_in_check(pos, FLIP_COLOR(pos->stm));
+}
+
+static void search_position(struct batch_job *job)
+{
+    struct gamestate *state = job->state;
+
+    state->sd = (search_depth > 0)?search_depth:MAX_SEARCH_DEPTH;
+    state->max_nodes = search_nodes;
+    state->silent = true;
+    state->exit_on_mate = true;
+    smp_search_isolated(job->worker, state);
+    job->npositions++;
+}
+
+static int search_score(struct batch_job *job)
+{
+    struct gamestate *state = job->state;
+
+    /*
+     * If not even the first iteration was completed then there
+     * is no score and the best move is the first legal move.
+     */
+    if (state->best_move == NOMOVE) {
+        return board_in_check(&state->pos, state->pos.stm)?-CHECKMATE:0;
+    }
+    return (state->completed_depth > 0)?job->worker->mpv_lines[0].score:0;
+}
+
+static char* read_epd_position(FILE *fp)
+{
+    char buffer[BATCH_MAX_LINE_LENGTH];
+
+    /* Find the next non-empty line */
+    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+        strip_line(buffer);
+        if (buffer[0] != '\0') {
+            return strdup(buffer);
+        }
+    }
+    return NULL;
+}
+
+/* EPD opcodes that are replaced by the result of the analysis */
+static char *result_opcodes[] = {"bm", "ce", "acd", "acn", "pv", NULL};
+
+static bool is_result_opcode(char *op)
+{
+    size_t len;
+    int    k;
+
+    len = strcspn(op, " \t;");
+    for (k=0;result_opcodes[k]!=NULL;k++) {
+        if ((strlen(result_opcodes[k]) == len) &&
+            !strncmp(op, result_opcodes[k], len)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Copy an EPD line, leaving out any operations that are
+ * replaced by the result of the analysis. The destination must
+ * have room for at least as many characters as the line.
+ */
+static void copy_epd_line(char *dst, char *epd)
+{
+    char *iter = epd;
+    char *end;
+    bool in_string;
+    int  k;
+
+    /* Copy the position fields */
+    for (k=0;k<4;k++) {
+        iter = skip_whitespace(iter);
+        while ((*iter != '\0') && !isspace((unsigned char)*iter)) {
+            iter++;
+        }
+    }
+    strncpy(dst, epd, iter-epd);
+    dst[iter-epd] = '\0';
+
+    /* Copy the operations, semicolons inside strings do not end them */
+    iter = skip_whitespace(iter);
+    while (*iter != '\0') {
+        in_string = false;
+        for (end=iter;(*end != '\0') && (in_string || (*end != ';'));end++) {
+            if (*end == '"') {
+                in_string = !in_string;
+            }
+        }
+        if (*end == ';') {
+            end++;
+        }
+        if (!is_result_opcode(iter)) {
+            strcat(dst, " ");
+            strncat(dst, iter, end-iter);
+        }
+        iter = skip_whitespace(end);
+    }
+}
+
+static char* analyze_epd_position(struct batch_job *job, char *epd)
+{
+    struct gamestate *state = job->state;
+    struct pvinfo    *line = &job->worker->mpv_lines[0];
+    char             *result;
+    char             *iter;
+    char             sanstr[MAX_SANSTR_LENGTH+1];
+    int              nmoves;
+    int              k;
+
+    if (!setup_position(&state->pos, epd)) {
+        return NULL;
+    }
+    search_position(job);
+
+    result = malloc(strlen(epd) + 128 +
+                    (line->pv.size+1)*(MAX_SANSTR_LENGTH+1));
+    if (result == NULL) {
+        return NULL;
+    }
+    copy_epd_line(result, epd);
+    iter = result + strlen(result);
+
+    /* There is no best move if the side to move has no legal moves */
+    if (state->best_move != NOMOVE) {
+        move2san(state->best_move, &state->pos, sanstr);
+        iter += sprintf(iter, " bm %s;", sanstr);
+    }
+    iter += sprintf(iter, " ce %d; acd %d; acn %"PRIu64";",
+                    search_score(job), (int)state->completed_depth,
+                    STATS_GET(job->worker->stats.nodes));
+
+    /*
+     * The moves of the principle variation have to be played
+     * on the board in order to be converted to SAN.
+     */
+    if ((state->completed_depth > 0) && (line->pv.size > 0)) {
+        iter += sprintf(iter, " pv");
+        nmoves = 0;
+        for (k=0;k<line->pv.size;k++) {
+            if (!board_is_move_pseudo_legal(&state->pos, line->pv.moves[k])) {
+                break;
+            }
+            move2san(line->pv.moves[k], &state->pos, sanstr);
+            if (!board_make_move(&state->pos, line->pv.moves[k])) {
+                break;
+            }
+            nmoves++;
+            iter += sprintf(iter, " %s", sanstr);
+        }
+        for (k=0;k<nmoves;k++) {
+            board_unmake_move(&state->pos);
+        }
+        strcat(iter, ";");
+    }
+
+    return result;
+}
+
+static char* read_pgn_game(FILE *fp)
+{
+    struct text text = {NULL, 0, 0, 0, false};
+    char        buffer[BATCH_MAX_LINE_LENGTH];
+    bool        in_movetext;
+    int         depth;
+    char        *iter;
+
+    in_movetext = false;
+    depth = 0;
+    while (true) {
+        /* Get the next line */
+        if (has_pending_line) {
+            strcpy(buffer, pending_line);
+            has_pending_line = false;
+        } else if (fgets(buffer, sizeof(buffer), fp) == NULL) {
+            break;
+        }
+        strip_line(buffer);
+        if ((buffer[0] == '\0') && (text.length == 0)) {
+            continue;
+        }
+
+        /*
+         * A tag outside of a comment after the movetext
+         * is the start of the next game.
+         */
+        if ((buffer[0] == '[') && (depth == 0)) {
+            if (in_movetext) {
+                strcpy(pending_line, buffer);
+                has_pending_line = true;
+                break;
+            }
+        } else if (buffer[0] != '\0') {
+            in_movetext = true;
+            for (iter=buffer;*iter!='\0';iter++) {
+                if (*iter == '{') {
+                    depth++;
+                } else if ((*iter == '}') && (depth > 0)) {
+                    depth--;
+                }
+            }
+        }
+        text_append(&text, buffer);
+        text_append(&text, "\n");
+    }
+
+    return text.buffer;
+}
+
+static char* next_pgn_token(char **iter, char *token, int size)
+{
+    char *str = *iter;
+    int  depth;
+    int  len;
+
+    while (true) {
+        str = skip_whitespace(str);
+        if (*str == '\0') {
+            return NULL;
+        } else if (*str == '{') {
+            /* Comment */
+            str = strchr(str, '}');
+            if (str == NULL) {
+                return NULL;
+            }
+            str++;
+        } else if (*str == ';') {
+            /* Comment to the end of the line */
+            str = strchr(str, '\n');
+            if (str == NULL) {
+                return NULL;
+            }
+        } else if (*str == '(') {
+            /* Variation, which may contain other variations */
+            depth = 0;
+            while (*str != '\0') {
+                if (*str == '(') {
+                    depth++;
+                } else if (*str == ')') {
+                    depth--;
+                    if (depth == 0) {
+                        str++;
+                        break;
+                    }
+                } else if (*str == '{') {
+                    str = strchr(str, '}');
+                    if (str == NULL) {
+                        return NULL;
+                    }
+                }
+                str++;
+            }
+        } else if (*str == ')') {
+            /* Unbalanced end of a variation */
+            str++;
+        } else if ((*str == '$') || (*str == '!') || (*str == '?')) {
+            /* Numeric or symbolic annotation glyph */
+            while ((*str != '\0') && !isspace((unsigned char)*str)) {
+                str++;
+            }
+        } else if ((*str >= '0') && (*str <= '9') &&
+                   (strncmp(str, "0-0", 3) != 0) &&
+                   (strncmp(str, "0-1", 3) != 0) &&
+                   (strncmp(str, "1-0", 3) != 0) &&
+                   (strncmp(str, "1/2-1/2", 7) != 0)) {
+            /* Move number */
+            while (((*str >= '0') && (*str <= '9')) || (*str == '.')) {
+                str++;
+            }
+        } else {
+            break;
+        }
+    }
+
+    /* Copy the token */
+    len = 0;
+    while ((*str != '\0') && !isspace((unsigned char)*str) && (*str != '{') &&
+           (*str != '(') && (*str != ')') && (*str != ';') &&
+           (len < (size-1))) {
+        token[len++] = *(str++);
+    }
+    token[len] = '\0';
+    *iter = str;
+
+    return token;
+}
+
+static void format_eval(int score, int depth, char *str)
+{
+    int moves;
+
+    if ((score >= FORCED_MATE) || (score <= -FORCED_MATE)) {
+        moves = (CHECKMATE - ((score > 0)?score:-score) + 1)/2;
+        sprintf(str, "#%s%d", (score > 0)?"":"-", moves);
+    } else {
+        sprintf(str, "%.2f", score/100.0);
+    }
+    sprintf(str+strlen(str), ",%d", depth);
+}
+
+static char* analyze_pgn_game(struct batch_job *job, char *game)
+{
+    struct gamestate *state = job->state;
+    struct position  *pos = &state->pos;
+    struct text      text = {NULL, 0, 0, 0, false};
+    char             fen[FEN_MAX_LENGTH];
+    char             token[BATCH_MAX_LINE_LENGTH];
+    char             result[8];
+    char             evalstr[32];
+    char             (*sans)[MAX_SANSTR_LENGTH+1];
+    char             (*best)[MAX_SANSTR_LENGTH+1];
+    int              *scores;
+    int              *depths;
+    int              *fullmoves;
+    int              *sides;
+    uint32_t         move;
+    char             *iter;
+    char             *end;
+    bool             playing;
+    int              nmoves;
+    int              k;
+
+    /* Copy the tag pair section and find the start position */
+    strcpy(fen, FEN_STARTPOS);
+    iter = game;
+    while (*iter == '[') {
+        end = strchr(iter, '\n');
+        if (end == NULL) {
+            free(text.buffer);
+            return NULL;
+        }
+        *end = '\0';
+        if (!strncmp(iter, "[FEN \"", 6) &&
+            (strlen(iter+6) < sizeof(fen))) {
+            strcpy(fen, iter+6);
+            if (strchr(fen, '"') != NULL) {
+                *strchr(fen, '"') = '\0';
+            }
+        }
+        text_append(&text, iter);
+        text_append(&text, "\n");
+        *end = '\n';
+        iter = end + 1;
+    }
+    text_append(&text, "\n");
+    text.line_length = 0;
+    if (text.failed || !setup_position(pos, fen)) {
+        free(text.buffer);
+        return NULL;
+    }
+
+    /* Play all moves of the game */
+    sans = malloc(BATCH_MAX_GAME_LENGTH*sizeof(*sans));
+    best = malloc((BATCH_MAX_GAME_LENGTH+1)*sizeof(*best));
+    scores = malloc((BATCH_MAX_GAME_LENGTH+1)*sizeof(int));
+    depths = malloc((BATCH_MAX_GAME_LENGTH+1)*sizeof(int));
+    fullmoves = malloc(BATCH_MAX_GAME_LENGTH*sizeof(int));
+    sides = malloc(BATCH_MAX_GAME_LENGTH*sizeof(int));
+    if ((sans == NULL) || (best == NULL) || (scores == NULL) ||
+        (depths == NULL) || (fullmoves == NULL) || (sides == NULL)) {
+        free(sans);
+        free(best);
+        free(scores);
+        free(depths);
+        free(fullmoves);
+        free(sides);
+        free(text.buffer);
+        return NULL;
+    }
+    strcpy(result, "*");
+    nmoves = 0;
+    playing = true;
+    while (next_pgn_token(&iter, token, sizeof(token)) != NULL) {
+        if (!strcmp(token, "1-0") || !strcmp(token, "0-1") ||
+            !strcmp(token, "1/2-1/2") || !strcmp(token, "*")) {
+            strcpy(result, token);
+            break;
+        }
+        if (!playing) {
+            continue;
+        }
+        move = san2move(token, pos);
+        if (move == NOMOVE) {
+            fprintf(stderr, "Illegal move %s, the rest of the game is "
+                    "ignored\n", token);
+            playing = false;
+            continue;
+        }
+        move2san(move, pos, sans[nmoves]);
+        fullmoves[nmoves] = pos->fullmove;
+        sides[nmoves] = pos->stm;
+        (void)board_make_move(pos, move);
+        nmoves++;
+        playing = nmoves < BATCH_MAX_GAME_LENGTH;
+    }
+
+    /*
+     * Analyze all positions starting from the end of the game. The
+     * transposition table entries from later positions then help when
+     * searching the earlier positions.
+     */
+    for (k=nmoves;k>=0;k--) {
+        search_position(job);
+        scores[k] = search_score(job);
+        if (pos->stm == BLACK) {
+            scores[k] = -scores[k];
+        }
+        depths[k] = state->completed_depth;
+        if (state->best_move != NOMOVE) {
+            move2san(state->best_move, pos, best[k]);
+        } else {
+            strcpy(best[k], "-");
+        }
+        if (k > 0) {
+            board_unmake_move(pos);
+        }
+    }
+
+    /*
+     * Write the moves. Each move is followed by a comment with the
+     * evaluation of the resulting position from white's point of view
+     * and the best move in the position where the move was played.
+     */
+    for (k=0;k<nmoves;k++) {
+        if (sides[k] == WHITE) {
+            sprintf(token, "%d.", fullmoves[k]);
+            text_append_token(&text, token);
+        } else {
+            sprintf(token, "%d...", fullmoves[k]);
+            text_append_token(&text, token);
+        }
+        text_append_token(&text, sans[k]);
+        format_eval(scores[k+1], depths[k+1], evalstr);
+        sprintf(token, "{[%%eval %s] bm %s}", evalstr, best[k]);
+        text_append_token(&text, token);
+    }
+    text_append_token(&text, result);
+    text_append(&text, "\n");
+
+    free(sans);
+    free(best);
+    free(scores);
+    free(depths);
+    free(fullmoves);
+    free(sides);
+
+    /* The buffer is NULL if building the annotated game failed */
+    return text.buffer;
+}
+
+static bool wait_for_item(int idx)
+{
+    bool eof;
+
+    while (true) {
+        eof = atomic_load(&end_of_input);
+        if (idx < atomic_load(&nitems)) {
+            return true;
+        }
+        if (eof) {
+            return false;
+        }
+        sleep_ms(1);
+    }
+}
+
+static thread_retval_t job_thread_func(void *data)
+{
+    struct batch_job  *job = data;
+    struct batch_item *item;
+    int               idx;
+
+    idx = atomic_fetch_add(&next_item, 1);
+    while (wait_for_item(idx)) {
+        item = &items[idx%nslots];
+        item->result = analyze_item(job, item->input);
+
+        /* Let the main thread know that the result is available */
+        atomic_store(&item->done, true);
+        event_set(&done_event);
+
+        idx = atomic_fetch_add(&next_item, 1);
+    }
+
+    return (thread_retval_t)0;
+}
+
+/*
+ * Wait for jobs to finish and release their resources. Returns
+ * the total number of positions analyzed by the jobs.
+ */
+static uint64_t stop_jobs(struct batch_job *jobs, int njobs)
+{
+    uint64_t npositions = 0ULL;
+    int      k;
+
+    for (k=0;k<njobs;k++) {
+        thread_join(&jobs[k].thread);
+        npositions += jobs[k].npositions;
+        smp_destroy_isolated_worker(jobs[k].worker);
+        free(jobs[k].state);
+    }
+    return npositions;
+}
+
+static bool run_batch(char *file, int njobs, int depth, uint64_t nodes,
+                      read_func_t read_item, analyze_func_t analyze)
+{
+    struct batch_job  *jobs;
+    struct batch_item *item;
+    FILE              *fp;
+    char              *input;
+    time_t            start;
+    time_t            total;
+    uint64_t          npositions;
+    bool              eof;
+    int               count;
+    int               written;
+    int               k;
+
+    assert(file != NULL);
+    assert(njobs > 0);
+
+    fp = fopen(file, "r");
+    if (fp == NULL) {
+        return false;
+    }
+    nslots = njobs*BATCH_SLOTS_PER_JOB;
+    items = malloc(nslots*sizeof(struct batch_item));
+    jobs = malloc(njobs*sizeof(struct batch_job));
+    if ((items == NULL) || (jobs == NULL)) {
+        free(items);
+        free(jobs);
+        fclose(fp);
+        return false;
+    }
+
+    /*
+     * Time control settings are shared by all searches so
+     * configure them once before starting the jobs.
+     */
+    search_depth = depth;
+    search_nodes = nodes;
+    analyze_item = analyze;
+    tc_configure_time_control(0, 0, 0, TC_INFINITE_TIME);
+    atomic_store(&nitems, 0);
+    atomic_store(&end_of_input, false);
+    atomic_store(&next_item, 0);
+    has_pending_line = false;
+    event_init(&done_event);
+
+    /* Start all jobs */
+    start = get_current_time();
+    for (k=0;k<njobs;k++) {
+        jobs[k].worker = smp_create_isolated_worker();
+        jobs[k].state = create_game_state();
+        if ((jobs[k].worker == NULL) || (jobs[k].state == NULL)) {
+            if (jobs[k].worker != NULL) {
+                smp_destroy_isolated_worker(jobs[k].worker);
+            }
+            free(jobs[k].state);
+
+            /* Let the jobs that are already running finish */
+            atomic_store(&end_of_input, true);
+            stop_jobs(jobs, k);
+            event_destroy(&done_event);
+            fclose(fp);
+            free(jobs);
+            free(items);
+            items = NULL;
+            return false;
+        }
+        jobs[k].npositions = 0ULL;
+        thread_create(&jobs[k].thread, (thread_func_t)job_thread_func,
+                      &jobs[k]);
+    }
+
+    /*
+     * Keep the ring buffer filled with items and write the results in
+     * the same order as the items in the file.
+     */
+    eof = false;
+    count = 0;
+    written = 0;
+    while (true) {
+        while (!eof && (count < (written+nslots))) {
+            input = read_item(fp);
+            if (input == NULL) {
+                eof = true;
+                atomic_store(&end_of_input, true);
+                break;
+            }
+            item = &items[count%nslots];
+            item->input = input;
+            item->result = NULL;
+            atomic_store(&item->done, false);
+            count++;
+            atomic_store(&nitems, count);
+        }
+        if (written == count) {
+            break;
+        }
+
+        item = &items[written%nslots];
+        while (!atomic_load(&item->done)) {
+            event_wait(&done_event);
+        }
+        if (item->result != NULL) {
+            printf("%s\n", item->result);
+        } else {
+            printf("%s\n", item->input);
+            fprintf(stderr, "Invalid input: %s\n", item->input);
+        }
+        fflush(stdout);
+        free(item->input);
+        free(item->result);
+        written++;
+    }
+    total = get_current_time() - start;
+
+    /* Wait for all jobs to finish */
+    npositions = stop_jobs(jobs, njobs);
+    fprintf(stderr, "Analyzed %"PRIu64" positions in %.2fs "
+            "(%.2f positions/s)\n", npositions, total/1000.0,
+            (total > 0)?(npositions*1000.0)/total:0.0);
+
+    /* Clean up */
+    event_destroy(&done_event);
+    fclose(fp);
+    free(jobs);
+    free(items);
+    items = NULL;
+
+    return true;
+}
+
+bool batch_analyze_epd(char *file, int njobs, int depth, uint64_t nodes)
+{
+    return run_batch(file, njobs, depth, nodes, read_epd_position,
+                     analyze_epd_position);
+}
+
+bool batch_annotate_pgn(char *file, int njobs, int depth, uint64_t nodes)
+{
+    return run_batch(file, njobs, depth, nodes, read_pgn_game,
+                     analyze_pgn_game);
+}
@@ -0,0 +1,63 @@
+/*
+ * Marvin - an UCI/XBoard compatible chess engine
+ * Copyright (C) 2015 Martin Danielsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The depth used when no search limit is specified */
+#define BATCH_DEFAULT_DEPTH 10
+
+/*
+ * Analyze all positions in an EPD file. The positions are distributed
+ * over a number of jobs that each run a single-threaded search, so
+ * that many positions are analyzed at the same time. The result for
+ * each position is written to stdout in the same order as in the file.
+ * The original EPD line is extended with the operations bm (best move),
+ * ce (score in centipawns), acd (completed depth), acn (number of nodes)
+ * and pv (principle variation).
+ *
+ * @param file The EPD file.
+ * @param njobs The number of searches to run at the same time.
+ * @param depth The depth to search each position to.
+ * @param nodes The maximum number of nodes to search for each position.
+ *              Zero means that there is no limit.
+ * @return Returns false if the file could not be read.
+ */
+bool batch_analyze_epd(char *file, int njobs, int depth, uint64_t nodes);
+
+/*
+ * Annotate all games in a PGN file. The games are distributed over a
+ * number of jobs in the same way as for batch_analyze_epd. Each game is
+ * written to stdout with its original tags and with a comment after
+ * every move. The comment contains the evaluation of the resulting
+ * position from white's point of view together with the completed
+ * depth, and the best move in the position where the move was played.
+ * Any comments and variations in the original game are dropped.
+ *
+ * @param file The PGN file.
+ * @param njobs The number of games to annotate at the same time.
+ * @param depth The depth to search each position to.
+ * @param nodes The maximum number of nodes to search for each position.
+ *              Zero means that there is no limit.
+ * @return Returns false if the file could not be read.
+ */
+bool batch_annotate_pgn(char *file, int njobs, int depth, uint64_t nodes);
+
+#endif
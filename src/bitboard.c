@@ -252,6 +252,18 @@ static uint64_t pawn_attacks_from_table[NSQUARES][NSIDES];
  */
 static uint64_t pawn_attacks_to_table[NSQUARES][NSIDES];
 
+/*
+ * Arrays containing bitboards of all squares between two squares on
+ * the same rank, file or diagonal (excluding the two squares).
+ */
+static uint64_t between_table[NSQUARES][NSQUARES];
+
+/*
+ * Arrays containing bitboards of the full line, from edge to edge,
+ * through two squares on the same rank, file or diagonal.
+ */
+static uint64_t line_table[NSQUARES][NSQUARES];
+
 /*
  * Generate a bitboard with all possible slider moves in a specified direction
  * for a given square/occupancy combination.
@@ -532,12 +544,47 @@ static void precalc_knight_moves(void)
     }
 }
 
+static void precalc_lines(void)
+{
+    int      offset_file[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+    int      offset_rank[8] = {0, -1, -1, -1, 0, 1, 1, 1};
+    int      sq;
+    int      ray;
+    int      file;
+    int      rank;
+    int      to;
+    uint64_t between;
+    uint64_t line;
+
+    for (sq=0;sq<NSQUARES;sq++) {
+        for (ray=0;ray<8;ray++) {
+            line = get_slider_moves(sq, offset_file[ray], offset_rank[ray],
+                                    0ULL) |
+                   get_slider_moves(sq, -offset_file[ray], -offset_rank[ray],
+                                    0ULL) |
+                   sq_mask[sq];
+            between = 0ULL;
+            file = FILENR(sq) + offset_file[ray];
+            rank = RANKNR(sq) + offset_rank[ray];
+            while ((file > -1) && (file < 8) && (rank > -1) && (rank < 8)) {
+                to = SQUARE(file, rank);
+                between_table[sq][to] = between;
+                line_table[sq][to] = line;
+                SETBIT(between, to);
+                file += offset_file[ray];
+                rank += offset_rank[ray];
+            }
+        }
+    }
+}
+
 void bb_init(void)
 {
     init_magic_databases();
     precalc_pawn_moves();
     precalc_king_moves();
     precalc_knight_moves();
+    precalc_lines();
 }
 
 uint64_t bb_pawn_moves(uint64_t occ, int from, int side)
@@ -616,6 +663,22 @@ uint64_t bb_pawn_attacks_to(int to, int side)
     return pawn_attacks_to_table[to][side];
 }
 
+uint64_t bb_between(int sq1, int sq2)
+{
+    assert(valid_square(sq1));
+    assert(valid_square(sq2));
+
+    return between_table[sq1][sq2];
+}
+
+uint64_t bb_line(int sq1, int sq2)
+{
+    assert(valid_square(sq1));
+    assert(valid_square(sq2));
+
+    return line_table[sq1][sq2];
+}
+
 uint64_t bb_knight_moves(int from)
 {
     assert(valid_square(from));
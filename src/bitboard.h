@@ -98,6 +98,28 @@ uint64_t bb_pawn_attacks_from(int from, int side);
  */
 uint64_t bb_pawn_attacks_to(int to, int side);
 
+/*
+ * Get the squares between two squares on the same rank, file
+ * or diagonal.
+ *
+ * @param sq1 The first square.
+ * @param sq2 The second square.
+ * @return Bitboard of the squares between, excluding sq1 and sq2. Empty
+ *         if the squares are not on the same line.
+ */
+uint64_t bb_between(int sq1, int sq2);
+
+/*
+ * Get the full line, from edge to edge, through two squares on the same
+ * rank, file or diagonal.
+ *
+ * @param sq1 The first square.
+ * @param sq2 The second square.
+ * @return Bitboard of the line. Empty if the squares are not on the
+ *         same line.
+ */
+uint64_t bb_line(int sq1, int sq2);
+
 /*
  * Generate a bitboard of knight moves.
  *
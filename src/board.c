@@ -16,6 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -197,6 +198,7 @@ void board_reset(struct position *pos)
 
     pos->key = 0ULL;
     pos->pawnkey = 0ULL;
+    pos->materialkey = 0ULL;
 
     pos->ep_sq = NO_SQUARE;
     pos->castle = 0;
@@ -223,6 +225,15 @@ bool board_setup_from_fen(struct position *pos, char *fenstr)
     return fen_setup_board(pos, fenstr) && valid_position(pos);
 }
 
+void board_copy(struct position *dst, struct position *src)
+{
+    assert(dst != NULL);
+    assert(src != NULL);
+    assert((src->ply >= 0) && (src->ply <= MAX_HISTORY_SIZE));
+
+    memcpy(dst, src, offsetof(struct position, history));
+    memcpy(dst->history, src->history, src->ply*sizeof(struct unmake));
+}
 
 bool board_in_check(struct position *pos, int side)
 {
@@ -233,7 +244,7 @@ bool board_in_check(struct position *pos, int side)
                           FLIP_COLOR(side));
 }
 
-bool board_make_move(struct position *pos, uint32_t move)
+static void execute_move(struct position *pos, uint32_t move)
 {
     struct unmake *elem;
     int           capture;
@@ -266,6 +277,7 @@ bool board_make_move(struct position *pos, uint32_t move)
     elem->fifty = pos->fifty;
     elem->key = pos->key;
     elem->pawnkey = pos->pawnkey;
+    elem->materialkey = pos->materialkey;
 
     /* Check if the move enables an en passant capture */
     if ((VALUE(piece) == PAWN) && (abs(to-from) == 16)) {
@@ -294,18 +306,23 @@ bool board_make_move(struct position *pos, uint32_t move)
         if (VALUE(capture) == PAWN) {
             pos->pawnkey = key_update_piece(pos->pawnkey, capture, to);
         }
+        pos->materialkey = key_remove_material(pos->materialkey, capture);
     } else if (ISENPASSANT(move)) {
         ep = (pos->stm == WHITE)?to-8:to+8;
         remove_piece(pos, PAWN+FLIP_COLOR(pos->stm), ep);
         pos->key = key_update_piece(pos->key, PAWN+FLIP_COLOR(pos->stm), ep);
         pos->pawnkey = key_update_piece(pos->pawnkey, PAWN+FLIP_COLOR(pos->stm),
                                         ep);
+        pos->materialkey = key_remove_material(pos->materialkey,
+                                               PAWN+FLIP_COLOR(pos->stm));
     }
 
     /* Add piece to new position */
     if (ISPROMOTION(move)) {
         add_piece(pos, promotion, to);
         pos->key = key_update_piece(pos->key, promotion, to);
+        pos->materialkey = key_remove_material(pos->materialkey, piece);
+        pos->materialkey = key_add_material(pos->materialkey, promotion);
     } else {
         add_piece(pos, piece, to);
         pos->key = key_update_piece(pos->key, piece, to);
@@ -348,6 +365,11 @@ bool board_make_move(struct position *pos, uint32_t move)
 
     /* Update bitboard of all pieces */
     pos->bb_all = pos->bb_sides[WHITE]|pos->bb_sides[BLACK];
+}
+
+bool board_make_move(struct position *pos, uint32_t move)
+{
+    execute_move(pos, move);
 
     /*
      * If the king was left in check then the move
@@ -360,11 +382,23 @@ bool board_make_move(struct position *pos, uint32_t move)
 
     assert(pos->key == key_generate(pos));
     assert(pos->pawnkey == key_generate_pawnkey(pos));
+    assert(pos->materialkey == key_generate_materialkey(pos));
     assert(valid_position(pos));
 
     return true;
 }
 
+void board_make_legal_move(struct position *pos, uint32_t move)
+{
+    execute_move(pos, move);
+
+    assert(!board_in_check(pos, FLIP_COLOR(pos->stm)));
+    assert(pos->key == key_generate(pos));
+    assert(pos->pawnkey == key_generate_pawnkey(pos));
+    assert(pos->materialkey == key_generate_materialkey(pos));
+    assert(valid_position(pos));
+}
+
 void board_unmake_move(struct position *pos)
 {
     struct unmake *elem;
@@ -385,6 +419,7 @@ void board_unmake_move(struct position *pos)
     pos->fifty = elem->fifty;
     pos->key = elem->key;
     pos->pawnkey = elem->pawnkey;
+    pos->materialkey = elem->materialkey;
 
     /* Extract some information for later use */
     to = TO(move);
@@ -436,6 +471,7 @@ void board_unmake_move(struct position *pos)
 
     assert(pos->key == key_generate(pos));
     assert(pos->pawnkey == key_generate_pawnkey(pos));
+    assert(pos->materialkey == key_generate_materialkey(pos));
     assert(valid_position(pos));
 }
 
@@ -456,6 +492,7 @@ void board_make_null_move(struct position *pos)
     elem->fifty = pos->fifty;
     elem->key = pos->key;
     elem->pawnkey = pos->pawnkey;
+    elem->materialkey = pos->materialkey;
 
     /* Update the state structure */
     pos->ep_sq = NO_SQUARE;
@@ -474,6 +511,7 @@ void board_make_null_move(struct position *pos)
 
     assert(pos->key == key_generate(pos));
     assert(pos->pawnkey == key_generate_pawnkey(pos));
+    assert(pos->materialkey == key_generate_materialkey(pos));
     assert(valid_position(pos));
 }
 
@@ -491,6 +529,7 @@ void board_unmake_null_move(struct position *pos)
     pos->fifty = elem->fifty;
     pos->key = elem->key;
     pos->pawnkey = elem->pawnkey;
+    pos->materialkey = elem->materialkey;
 
     /* Update the state structure */
     if (pos->stm == WHITE) {
@@ -500,6 +539,7 @@ void board_unmake_null_move(struct position *pos)
 
     assert(pos->key == key_generate(pos));
     assert(pos->pawnkey == key_generate_pawnkey(pos));
+    assert(pos->materialkey == key_generate_materialkey(pos));
     assert(valid_position(pos));
 }
 
@@ -703,7 +743,11 @@ bool board_is_move_pseudo_legal(struct position *pos, uint32_t move)
     return (bb&sq_mask[to]) != 0ULL;
 }
 
-bool board_move_gives_check(struct position *pos, uint32_t move)
+/*
+ * Check if a move gives check by making it on the board. Used for
+ * special moves that are not handled by board_move_gives_check.
+ */
+static bool move_gives_check_slow(struct position *pos, uint32_t move)
 {
     bool gives_check;
     int  from;
@@ -783,6 +827,159 @@ bool board_move_gives_check(struct position *pos, uint32_t move)
     return gives_check;
 }
 
+/*
+ * Find all pieces that are the only piece between a king and
+ * an enemy slider, i.e. pieces that block a slider attack.
+ */
+static uint64_t find_blockers(struct position *pos, int kingsq, int side)
+{
+    uint64_t snipers;
+    uint64_t between;
+    uint64_t blockers;
+    int      sq;
+
+    snipers = (bb_rook_moves(0ULL, kingsq)&
+               (pos->bb_pieces[ROOK+side]|pos->bb_pieces[QUEEN+side])) |
+              (bb_bishop_moves(0ULL, kingsq)&
+               (pos->bb_pieces[BISHOP+side]|pos->bb_pieces[QUEEN+side]));
+    blockers = 0ULL;
+    while (snipers != 0ULL) {
+        sq = POPBIT(&snipers);
+        between = bb_between(kingsq, sq)&pos->bb_all;
+        if ((between != 0ULL) && ((between&(between-1)) == 0ULL)) {
+            blockers |= between;
+        }
+    }
+
+    return blockers;
+}
+
+void board_init_checkinfo(struct position *pos, struct checkinfo *ci)
+{
+    int      stm;
+    int      opp;
+    uint64_t bishop;
+    uint64_t rook;
+
+    assert(valid_position(pos));
+    assert(ci != NULL);
+
+    stm = pos->stm;
+    opp = FLIP_COLOR(stm);
+    ci->king_sq = LSB(pos->bb_pieces[KING+stm]);
+    ci->opp_king_sq = LSB(pos->bb_pieces[KING+opp]);
+
+    /* Find checks and pins */
+    ci->checkers = bb_attacks_to(pos, pos->bb_all, ci->king_sq, opp);
+    ci->pinned = find_blockers(pos, ci->king_sq, opp)&pos->bb_sides[stm];
+    ci->discoverers = find_blockers(pos, ci->opp_king_sq, stm)&
+                                                        pos->bb_sides[stm];
+
+    /* Find the squares where each piece gives check */
+    bishop = bb_bishop_moves(pos->bb_all, ci->opp_king_sq);
+    rook = bb_rook_moves(pos->bb_all, ci->opp_king_sq);
+    ci->check_squares[PAWN+stm] = bb_pawn_attacks_to(ci->opp_king_sq, stm);
+    ci->check_squares[KNIGHT+stm] = bb_knight_moves(ci->opp_king_sq);
+    ci->check_squares[BISHOP+stm] = bishop;
+    ci->check_squares[ROOK+stm] = rook;
+    ci->check_squares[QUEEN+stm] = bishop|rook;
+    ci->check_squares[KING+stm] = 0ULL;
+}
+
+bool board_is_move_legal(struct position *pos, uint32_t move,
+                         struct checkinfo *ci)
+{
+    int      from;
+    int      to;
+    int      opp;
+    int      capsq;
+    uint64_t occ;
+
+    assert(valid_position(pos));
+    assert(valid_move(move));
+    assert(board_is_move_pseudo_legal(pos, move));
+    assert(ci != NULL);
+
+    from = FROM(move);
+    to = TO(move);
+    opp = FLIP_COLOR(pos->stm);
+
+    /*
+     * For en passant captures two pieces are removed from the same
+     * rank so check the resulting position for attacks on the king.
+     */
+    if (ISENPASSANT(move)) {
+        capsq = (pos->stm == WHITE)?to-8:to+8;
+        occ = (pos->bb_all&~sq_mask[from]&~sq_mask[capsq])|sq_mask[to];
+        return (bb_attacks_to(pos, occ, ci->king_sq, opp)&
+                                                ~sq_mask[capsq]) == 0ULL;
+    }
+
+    /*
+     * The king must not move to an attacked square. The king is removed
+     * from the board first so that it doesn't block slider attacks.
+     */
+    if (from == ci->king_sq) {
+        occ = pos->bb_all&~sq_mask[from];
+        return bb_attacks_to(pos, occ, to, opp) == 0ULL;
+    }
+
+    /*
+     * If the king is in check then the checking piece must be
+     * captured or blocked. A double check can only be handled
+     * by moving the king.
+     */
+    if (ci->checkers != 0ULL) {
+        if ((ci->checkers&(ci->checkers-1)) != 0ULL) {
+            return false;
+        }
+        if (((bb_between(ci->king_sq, LSB(ci->checkers))|ci->checkers)&
+                                                        sq_mask[to]) == 0ULL) {
+            return false;
+        }
+    }
+
+    /* A pinned piece can only move along the line of the pin */
+    return ((ci->pinned&sq_mask[from]) == 0ULL) ||
+           ((bb_line(from, ci->king_sq)&sq_mask[to]) != 0ULL);
+}
+
+bool board_move_gives_check(struct position *pos, uint32_t move,
+                            struct checkinfo *ci)
+{
+    bool gives_check;
+    int  from;
+    int  to;
+
+    assert(valid_position(pos));
+    assert(valid_move(move));
+    assert(move != NOMOVE);
+    assert(ci != NULL);
+
+    /* Handle special moves separatly to simplify the rest of the code */
+    if (ISENPASSANT(move) || ISPROMOTION(move) ||
+        ISKINGSIDECASTLE(move) || ISQUEENSIDECASTLE(move)) {
+        return move_gives_check_slow(pos, move);
+    }
+
+    from = FROM(move);
+    to = TO(move);
+
+    /*
+     * The move gives check if the piece attacks the king from its new
+     * square or if it uncovers an attack from a slider behind it.
+     */
+    gives_check =
+        ((ci->check_squares[pos->pieces[from]]&sq_mask[to]) != 0ULL) ||
+        (((ci->discoverers&sq_mask[from]) != 0ULL) &&
+         ((bb_line(from, ci->opp_king_sq)&sq_mask[to]) == 0ULL));
+    assert((gives_check == move_gives_check_slow(pos, move)) ||
+           ((from == ci->king_sq) &&
+            ((bb_king_moves(to)&sq_mask[ci->opp_king_sq]) != 0ULL)));
+
+    return gives_check;
+}
+
 void board_quiet(struct position *pos, struct movelist *pv)
 {
     pv->size = 0;
@@ -45,6 +45,15 @@ void board_start_position(struct position *pos);
  */
 bool board_setup_from_fen(struct position *pos, char *fenstr);
 
+/*
+ * Copy a position. Only the part of the game history that is in use
+ * is copied which makes this much cheaper than a plain struct copy.
+ *
+ * @param dst The position to copy to.
+ * @param src The position to copy from.
+ */
+void board_copy(struct position *dst, struct position *src);
+
 /*
  * Tests if a player is in check.
  *
@@ -65,6 +74,16 @@ bool board_in_check(struct position *pos, int side);
  */
 bool board_make_move(struct position *pos, uint32_t move);
 
+/*
+ * Make a move that is known to be legal, for instance as determined by
+ * board_is_move_legal. Compared to board_make_move the test for leaving
+ * the king in check is skipped.
+ *
+ * @param pos The chess board.
+ * @param move The move to make.
+ */
+void board_make_legal_move(struct position *pos, uint32_t move);
+
 /*
  * Undo the last move.
  *
@@ -111,13 +130,35 @@ bool board_has_non_pawn(struct position *pos, int side);
  */
 bool board_is_move_pseudo_legal(struct position *pos, uint32_t move);
 
+/*
+ * Calculate check and pin information for the side to move.
+ *
+ * @param pos The chess board.
+ * @param ci Location to store the information at.
+ */
+void board_init_checkinfo(struct position *pos, struct checkinfo *ci);
+
+/*
+ * Check if a pseudo-legal move is legal, that is if it does not leave
+ * the own king in check.
+ *
+ * @param pos The chess board.
+ * @param move The move to check.
+ * @param ci Check information for the position.
+ * @return Returns true if the move is legal.
+ */
+bool board_is_move_legal(struct position *pos, uint32_t move,
+                         struct checkinfo *ci);
+
 /*
  * Check if a move is a checking move.
  *
  * @param pos The chess board.
  * @param move The move to check.
+ * @param ci Check information for the position.
  */
-bool board_move_gives_check(struct position *pos, uint32_t move);
+bool board_move_gives_check(struct position *pos, uint32_t move,
+                            struct checkinfo *ci);
 
 /* Calcualte the point value balance for a position.
  *
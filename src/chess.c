@@ -470,3 +470,255 @@ uint32_t str2move(char *str, struct position *pos)
 
     return NOMOVE;
 }
+
+void move2san(uint32_t move, struct position *pos, char *str)
+{
+    struct movelist list;
+    uint32_t        other;
+    int             from;
+    int             to;
+    int             piece;
+    bool            ambiguous;
+    bool            same_file;
+    bool            same_rank;
+    char            *iter;
+    int             k;
+
+    assert(valid_position(pos));
+    assert(str != NULL);
+
+    if (move == NOMOVE) {
+        strcpy(str, "(none)");
+        return;
+    }
+
+    from = FROM(move);
+    to = TO(move);
+    piece = pos->pieces[from];
+    iter = str;
+
+    if (ISKINGSIDECASTLE(move)) {
+        strcpy(iter, "O-O");
+        iter += 3;
+    } else if (ISQUEENSIDECASTLE(move)) {
+        strcpy(iter, "O-O-O");
+        iter += 5;
+    } else {
+        if (VALUE(piece) == PAWN) {
+            /* Pawn captures are prefixed with the file of the pawn */
+            if (ISCAPTURE(move) || ISENPASSANT(move)) {
+                *(iter++) = FILENR(from) + 'a';
+                *(iter++) = 'x';
+            }
+        } else {
+            *(iter++) = piece2char[VALUE(piece)];
+
+            /*
+             * If another piece of the same kind can move to the same
+             * square then add the file and/or rank of the moving piece.
+             */
+            ambiguous = false;
+            same_file = false;
+            same_rank = false;
+            gen_legal_moves(pos, &list);
+            for (k=0;k<list.size;k++) {
+                other = list.moves[k];
+                if ((other == move) || (TO(other) != to) ||
+                    (pos->pieces[FROM(other)] != piece)) {
+                    continue;
+                }
+                ambiguous = true;
+                if (FILENR(FROM(other)) == FILENR(from)) {
+                    same_file = true;
+                }
+                if (RANKNR(FROM(other)) == RANKNR(from)) {
+                    same_rank = true;
+                }
+            }
+            if (ambiguous) {
+                if (!same_file) {
+                    *(iter++) = FILENR(from) + 'a';
+                } else if (!same_rank) {
+                    *(iter++) = RANKNR(from) + '1';
+                } else {
+                    *(iter++) = FILENR(from) + 'a';
+                    *(iter++) = RANKNR(from) + '1';
+                }
+            }
+            if (ISCAPTURE(move)) {
+                *(iter++) = 'x';
+            }
+        }
+
+        *(iter++) = FILENR(to) + 'a';
+        *(iter++) = RANKNR(to) + '1';
+        if (ISPROMOTION(move)) {
+            *(iter++) = '=';
+            *(iter++) = piece2char[VALUE(PROMOTION(move))];
+        }
+    }
+
+    /* Mark checks and mates */
+    if (board_make_move(pos, move)) {
+        if (board_in_check(pos, pos->stm)) {
+            gen_legal_moves(pos, &list);
+            *(iter++) = (list.size == 0)?'#':'+';
+        }
+        board_unmake_move(pos);
+    }
+    *iter = '\0';
+}
+
+uint32_t san2move(char *str, struct position *pos)
+{
+    struct movelist list;
+    uint32_t        move;
+    uint32_t        found;
+    int             piece;
+    int             promotion;
+    int             files[3];
+    int             ranks[3];
+    int             nsquares;
+    int             from_file;
+    int             from_rank;
+    int             to;
+    int             k;
+
+    assert(str != NULL);
+    assert(valid_position(pos));
+
+    gen_legal_moves(pos, &list);
+
+    /* Castling, written with either letter O or digit zero */
+    if (!strncmp(str, "O-O-O", 5) || !strncmp(str, "0-0-0", 5)) {
+        for (k=0;k<list.size;k++) {
+            if (ISQUEENSIDECASTLE(list.moves[k])) {
+                return list.moves[k];
+            }
+        }
+        return NOMOVE;
+    } else if (!strncmp(str, "O-O", 3) || !strncmp(str, "0-0", 3)) {
+        for (k=0;k<list.size;k++) {
+            if (ISKINGSIDECASTLE(list.moves[k])) {
+                return list.moves[k];
+            }
+        }
+        return NOMOVE;
+    }
+
+    /* Moving piece */
+    piece = PAWN;
+    switch (*str) {
+    case 'N':
+        piece = KNIGHT;
+        str++;
+        break;
+    case 'B':
+        piece = BISHOP;
+        str++;
+        break;
+    case 'R':
+        piece = ROOK;
+        str++;
+        break;
+    case 'Q':
+        piece = QUEEN;
+        str++;
+        break;
+    case 'K':
+        piece = KING;
+        str++;
+        break;
+    default:
+        break;
+    }
+
+    /*
+     * Collect files and ranks. The last square is the destination and
+     * anything before it disambiguates the moving piece.
+     */
+    nsquares = 0;
+    files[0] = -1;
+    ranks[0] = -1;
+    while ((*str != '\0') && (*str != '=') && (nsquares < 3)) {
+        if ((*str >= 'a') && (*str <= 'h')) {
+            /* A lone letter after the destination is a promotion */
+            if ((nsquares > 0) && (ranks[nsquares-1] >= 0) &&
+                ((*(str+1) < '1') || (*(str+1) > '8'))) {
+                break;
+            }
+            files[nsquares] = *str - 'a';
+            ranks[nsquares] = -1;
+            if ((*(str+1) >= '1') && (*(str+1) <= '8')) {
+                ranks[nsquares] = *(str+1) - '1';
+                str++;
+            }
+            nsquares++;
+        } else if ((*str >= '1') && (*str <= '8')) {
+            files[nsquares] = -1;
+            ranks[nsquares] = *str - '1';
+            nsquares++;
+        } else if ((*str != 'x') && (*str != '-') && (*str != ':')) {
+            break;
+        }
+        str++;
+    }
+    if ((nsquares == 0) || (nsquares > 2) ||
+        (files[nsquares-1] < 0) || (ranks[nsquares-1] < 0)) {
+        return NOMOVE;
+    }
+    to = SQUARE(files[nsquares-1], ranks[nsquares-1]);
+    from_file = (nsquares == 2)?files[0]:-1;
+    from_rank = (nsquares == 2)?ranks[0]:-1;
+
+    /* Promotion piece, with or without a preceding equal sign */
+    if (*str == '=') {
+        str++;
+    }
+    switch (*str) {
+    case 'N':
+    case 'n':
+        promotion = KNIGHT;
+        break;
+    case 'B':
+    case 'b':
+        promotion = BISHOP;
+        break;
+    case 'R':
+    case 'r':
+        promotion = ROOK;
+        break;
+    case 'Q':
+    case 'q':
+        promotion = QUEEN;
+        break;
+    default:
+        promotion = NO_PIECE;
+        break;
+    }
+
+    /*
+     * Find the matching legal move. If the complete from square is
+     * given (coordinate notation) then the piece letter is optional.
+     */
+    found = NOMOVE;
+    for (k=0;k<list.size;k++) {
+        move = list.moves[k];
+        if ((TO(move) != to) ||
+            ((VALUE(pos->pieces[FROM(move)]) != piece) &&
+             ((piece != PAWN) || (from_file < 0) || (from_rank < 0))) ||
+            ((from_file >= 0) && (FILENR(FROM(move)) != from_file)) ||
+            ((from_rank >= 0) && (RANKNR(FROM(move)) != from_rank))) {
+            continue;
+        }
+        if (ISPROMOTION(move) && (VALUE(PROMOTION(move)) != promotion)) {
+            continue;
+        }
+        if (found != NOMOVE) {
+            return NOMOVE;
+        }
+        found = move;
+    }
+
+    return found;
+}
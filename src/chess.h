@@ -22,13 +22,18 @@
 #include <stdbool.h>
 #include <time.h>
 #include <setjmp.h>
+#include <stdatomic.h>
 
 #include "thread.h"
 #include "config.h"
+#include "utils.h"
 
 /* The maximum length of the string representation of a move */
 #define MAX_MOVESTR_LENGTH 7
 
+/* The maximum length of a move in standard algebraic notation */
+#define MAX_SANSTR_LENGTH 8
+
 /* The number of sides */
 #define NSIDES 2
 
@@ -256,6 +261,32 @@ struct pvinfo {
     int score;
 };
 
+/*
+ * Information about checks and pins for the side to move. It is
+ * calculated once for a position and then used for testing
+ * if moves are legal or give check.
+ */
+struct checkinfo {
+    /* The location of the king of the side to move */
+    int king_sq;
+    /* The location of the opponent king */
+    int opp_king_sq;
+    /* Opponent pieces that give check to the king */
+    uint64_t checkers;
+    /* Pieces of the side to move that are pinned to their own king */
+    uint64_t pinned;
+    /*
+     * Pieces of the side to move that give a discovered check if
+     * they move off the line to the opponent king.
+     */
+    uint64_t discoverers;
+    /*
+     * Squares from which each piece of the side to move gives
+     * direct check to the opponent king, indexed by piece.
+     */
+    uint64_t check_squares[NPIECES];
+};
+
 /*
  * Move selector struct. Holds information for finding the
  * next move to search for a specific position.
@@ -279,6 +310,8 @@ struct moveselector {
     int phase;
     /* Flag indicating if the player is in check */
     bool in_check;
+    /* Check and pin information used for skipping illegal moves */
+    struct checkinfo *ci;
     /* Flag indicating if underpromotions should be included */
     bool underpromote;
     /*
@@ -306,6 +339,8 @@ struct unmake {
     uint64_t key;
     /* The unique pawn key before the move was made */
     uint64_t pawnkey;
+    /* The material signature before the move was made */
+    uint64_t materialkey;
 };
 
 /* An opening book entry */
@@ -315,16 +350,11 @@ struct book_entry {
 };
 
 /*
- * An item in the main transposition table,
- * which represents a single position.
+ * An item in the main transposition table, which represents a single
+ * position. This is the unpacked form of an entry as returned by
+ * lookups in the table.
  */
 struct tt_item {
-    /*
-     * The key of this position. It is split into two parts in order to
-     * avoid the need for 8-byte alignment of the struct.
-     */
-    uint32_t key_low;
-    uint32_t key_high;
     /* The best move found */
     uint32_t move;
     /*
@@ -341,20 +371,50 @@ struct tt_item {
      * values are: EXACT, ALPHA, BETA and PV.
      */
     uint8_t type;
-    /* The time when the position was stored */
+    /* The generation when the position was stored */
     uint8_t date;
 };
 
+/*
+ * An entry in the main transposition table as it is stored in the table.
+ * Only the lower 24 bits of the position key are stored since the bucket
+ * is selected using the upper bits. The remaining 8 bits of the key word
+ * hold the epoch of the table when the entry was stored. Entries from
+ * an older epoch are considered empty, which makes it possible to clear
+ * the table without touching it.
+ *
+ * The table is shared between all workers without any locking so an entry
+ * can end up with parts from two different writes. To be able to detect
+ * this the key is stored xor:ed with both data words. If the key and the
+ * data comes from different writes then the recovered key will not match.
+ *
+ * The data is packed as follows:
+ * bit 0-15: the best move (encoded as 16 bits)
+ * bit 16-31: the score
+ * bit 32-47: the static evaluation
+ * bit 48-55: the depth
+ * bit 56-57: the type of the score plus one (zero for unused entries)
+ * bit 58-63: the generation when the entry was stored
+ */
+struct tt_entry {
+    /* The key and epoch of the entry xor:ed with the data */
+    uint32_t key;
+    /* The packed data, bit 0-31 */
+    uint32_t data_low;
+    /* The packed data, bit 32-63 */
+    uint32_t data_high;
+};
+
 /* The number of items stored in each transposition table bucket */
-#define TT_BUCKET_SIZE 3
+#define TT_BUCKET_SIZE 5
 
 /*
  * Transposition table bucket. The size should be a
  * power-of-2 for best performance.
  */
 struct tt_bucket {
-    /* Items stored in this bucket */
-    struct tt_item items[TT_BUCKET_SIZE];
+    /* Entries stored in this bucket */
+    struct tt_entry entries[TT_BUCKET_SIZE];
     /*
      * Padding added to make sure that the
      * size of the struct is a power-of-2.
@@ -392,13 +452,51 @@ struct pawntt_item {
     uint8_t padding[24];
 };
 
-/* Internal representation of a chess position */
-struct position {
+/* The number of items in the material transposition table (power-of-2) */
+#define MATERIALTT_SIZE 4096
+
+/* Flags for material transposition table items */
+#define MATERIAL_DRAW           0x01
+#define MATERIAL_BISHOPS_ONLY   0x02
+
+/*
+ * An item in the material transposition table. The size should be a
+ * power-of-2 for best performance.
+ */
+struct materialtt_item {
+    /* The material signature, zero for unused items */
+    uint64_t materialkey;
+    /* The score of material related terms for each side */
+    int16_t score[NPHASES][NSIDES];
+    /* The game phase value */
+    int16_t phase;
     /*
-     * Location of each piece on the board. An
-     * empty square is identified NO_PIECE.
+     * Draw flags. MATERIAL_DRAW means that neither side can win.
+     * MATERIAL_BISHOPS_ONLY means that one side only has bishops
+     * left and that it is a draw if they are on the same color.
      */
-    int pieces[NSQUARES];
+    uint8_t flags;
+    /*
+     * Padding added to make sure that the
+     * size of the struct is a power-of-2.
+     */
+    uint8_t padding[13];
+};
+
+/*
+ * The number of entries in the evaluation cache (power-of-2). Each entry
+ * holds the upper 48 bits of the position key and the static evaluation
+ * of the position in the lower 16 bits.
+ */
+#define EVALCACHE_SIZE 8192
+
+/*
+ * Internal representation of a chess position. The fields that are used
+ * during the search come first and the game history is kept last so that
+ * a position can be copied with board_copy without copying the unused
+ * part of the history.
+ */
+struct position {
     /* Bitboards for the different pieces */
     uint64_t bb_pieces[NPIECES];
     /* Bitboards for the pieces of the different sides */
@@ -412,6 +510,17 @@ struct position {
      * the pawns in the current position.
      */
     uint64_t pawnkey;
+    /*
+     * Signature that uniquely identifies the material in the current
+     * position. The number of pieces of each kind is stored in four
+     * bits per piece, see key.h.
+     */
+    uint64_t materialkey;
+    /*
+     * Location of each piece on the board. An
+     * empty square is identified NO_PIECE.
+     */
+    uint8_t pieces[NSQUARES];
     /* The en-passant target square */
     int ep_sq;
     /* Castling availability for both sides */
@@ -426,15 +535,90 @@ struct position {
     int fifty;
     /* Fullmove counter */
     int fullmove;
-    /* Game history used for undoing moves */
-    struct unmake history[MAX_HISTORY_SIZE];
-    int eval_stack[MAX_HISTORY_SIZE];
 
     /* Pointers to the owning worker and the active game state */
     struct search_worker *worker;
     struct gamestate *state;
+
+    /*
+     * Game history used for undoing moves. Only the first ply entries
+     * are in use. Must be the last field, see board_copy.
+     */
+    struct unmake history[MAX_HISTORY_SIZE];
 };
 
+/*
+ * Statistics that are updated by a worker for every node. They are kept
+ * in their own cache lines so that the writes do not disturb other
+ * threads. The counters are read by other threads so they are atomic,
+ * but only the owning worker updates them.
+ */
+struct worker_stats {
+    /* The number of nodes searched so far */
+    _Alignas(CACHE_LINE_SIZE) atomic_uint_least64_t nodes;
+    /* The number of quiscence nodes searched so far */
+    atomic_uint_least64_t qnodes;
+    /* The number of tablebase hits */
+    atomic_uint_least64_t tbhits;
+    /* The current selective search depth in plies */
+    int seldepth;
+    /* The move currently being searched */
+    uint32_t currmove;
+    /* The number of the move currently being searched (one-based) */
+    int currmovenumber;
+};
+
+/*
+ * Update and read worker statistics counters. Only the owning worker
+ * updates a counter so a relaxed load and store is enough, which avoids
+ * the cost of an atomic read-modify-write operation.
+ */
+#define STATS_INC(c) atomic_store_explicit(&(c),                            \
+                        atomic_load_explicit(&(c), memory_order_relaxed)+1, \
+                        memory_order_relaxed)
+#define STATS_GET(c) atomic_load_explicit(&(c), memory_order_relaxed)
+
+/*
+ * Counters describing how the different pruning, reduction and extension
+ * techniques behave during the search. The counters are only maintained
+ * when the engine is built with stats=yes (SEARCH_STATS).
+ */
+enum search_stat {
+    SSTAT_NODES,
+    SSTAT_TT_PROBES,
+    SSTAT_TT_HITS,
+    SSTAT_TT_CUTOFFS,
+    SSTAT_RFP_PRUNES,
+    SSTAT_RAZOR_TRIES,
+    SSTAT_RAZOR_CUTOFFS,
+    SSTAT_NULL_TRIES,
+    SSTAT_NULL_CUTOFFS,
+    SSTAT_PROBCUT_TRIES,
+    SSTAT_PROBCUT_CUTOFFS,
+    SSTAT_SE_TRIES,
+    SSTAT_SE_EXTENSIONS,
+    SSTAT_FUTILITY_PRUNES,
+    SSTAT_LMP_PRUNES,
+    SSTAT_SEE_PRUNES,
+    SSTAT_HISTORY_PRUNES,
+    SSTAT_LMR_SEARCHES,
+    SSTAT_LMR_RESEARCHES,
+    SSTAT_FAIL_HIGHS,
+    SSTAT_FIRST_MOVE_FAIL_HIGHS,
+    NSEARCHSTATS
+};
+
+/*
+ * Update a search statistics counter for a node with a certain remaining
+ * depth. Expands to nothing unless the engine is built with SEARCH_STATS.
+ */
+#ifdef SEARCH_STATS
+#define SEARCH_STAT_INC(w, s, d) \
+                    (w)->search_stats[CLAMP((d), 0, MAX_SEARCH_DEPTH-1)][(s)]++
+#else
+#define SEARCH_STAT_INC(w, s, d) ((void)0)
+#endif
+
 /* Per-thread worker instance */
 struct search_worker {
     /* The id of this thread */
@@ -447,6 +631,11 @@ struct search_worker {
      * complete variation can be found in pv_table[0].
      */
     struct movelist pv_table[MAX_PLY];
+    /*
+     * The static evaluation of the positions in the current line,
+     * indexed by search ply.
+     */
+    int eval_stack[MAX_PLY];
     /* Tables used for killer move heuristics */
     uint32_t killer_table[MAX_PLY];
     /* Table used for counter move heuristics */
@@ -455,27 +644,28 @@ struct search_worker {
     int history_table[NPIECES][NSQUARES];
     int counter_history[NPIECES][NSQUARES][NPIECES][NSQUARES];
     int follow_history[NPIECES][NSQUARES][NPIECES][NSQUARES];
-    /* Pawn transposition table */
+    /* Pawn transposition table, possibly shared with other workers */
     struct pawntt_item *pawntt;
     /* The number of entries in the pawn transposition table */
     int pawntt_size;
+    /* The number of pawn transposition table lookups and hits */
+    uint64_t pawntt_probes;
+    uint64_t pawntt_hits;
+    /* Material transposition table */
+    struct materialtt_item materialtt[MATERIALTT_SIZE];
+    /* Cache of static evaluations */
+    uint64_t evalcache[EVALCACHE_SIZE];
     /* Indicates if the engine is resolving a fail-low at the root */
     bool resolving_root_fail;
     bool resolving_tt_fail;
-    /* The number of nodes searched so far */
-    uint64_t nodes;
-    /* The number of quiscence nodes searched so far */
-    uint64_t qnodes;
     /* The current search depth in plies */
     int depth;
-    /* The current selective search depth in plies */
-    int seldepth;
-    /* The move currently being searched */
-    uint32_t currmove;
-    /* The number of the move currently being searched (one-based) */
-    int currmovenumber;
-    /* The number of tablebase hits */
-    uint64_t tbhits;
+    /* Statistics updated for every node */
+    struct worker_stats stats;
+#ifdef SEARCH_STATS
+    /* Search statistics counters, indexed by remaining depth */
+    uint64_t search_stats[MAX_SEARCH_DEPTH][NSEARCHSTATS];
+#endif
 
     /* PV information */
     int multipv;
@@ -487,6 +677,18 @@ struct search_worker {
     thread_t thread;
     int action;
     jmp_buf env;
+    /* Events used to start a parked helper and to signal that it is done */
+    event_t start_event;
+    event_t done_event;
+    /* Time from the start of the search until the worker started (in us) */
+    uint64_t start_latency;
+    /*
+     * Flag indicating that the worker runs an isolated search that does
+     * not share any state with other workers, and the stop flag used for
+     * such searches.
+     */
+    bool isolated;
+    atomic_bool stop;
 
     /* Pointer to the active game state */
     struct gamestate *state;
@@ -511,6 +713,11 @@ struct gamestate {
     bool exit_on_mate;
     /* The maximum depth the engine should search to */
     int sd;
+    /*
+     * The maximum number of nodes the master worker should search. Zero
+     * means that there is no limit.
+     */
+    uint64_t max_nodes;
     /* Flag used to suppress output during search */
     bool silent;
     /*
@@ -521,8 +728,11 @@ struct gamestate {
     /* Information about the best move */
     uint32_t best_move;
     uint32_t ponder_move;
-    /* Information about the highest completed depth */
-    int completed_depth;
+    /*
+     * Information about the highest completed depth. Updated by
+     * all workers without locking.
+     */
+    atomic_int completed_depth;
     /* The number of lines to search */
     int multipv;
 };
@@ -684,4 +894,27 @@ void move2str(uint32_t move, char *str);
  */
 uint32_t str2move(char *str, struct position *pos);
 
+/*
+ * Convert a move into standard algebraic notation (SAN), for
+ * instance Nbd7, exd5, O-O or e8=Q+.
+ *
+ * @param move The move. It must be legal in the position.
+ * @param pos The position where the move is played.
+ * @param str Pointer to store the string at. It must have room for
+ *            at least MAX_SANSTR_LENGTH+1 characters.
+ */
+void move2san(uint32_t move, struct position *pos, char *str);
+
+/*
+ * Convert a move in standard algebraic notation (SAN) to the internal
+ * move format. Check and annotation symbols are ignored and moves in
+ * coordinate notation are also accepted.
+ *
+ * @param str The move.
+ * @param pos The current chess position.
+ * @return Returns the move, or NOMOVE if the string does not match
+ *         exactly one legal move.
+ */
+uint32_t san2move(char *str, struct position *pos);
+
 #endif
@@ -0,0 +1,699 @@
+/*
+ * Marvin - an UCI/XBoard compatible chess engine
+ * Copyright (C) 2015 Martin Danielsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WINDOWS
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "cluster.h"
+#include "board.h"
+#include "hash.h"
+#include "smp.h"
+#include "timectl.h"
+#include "thread.h"
+#include "utils.h"
+#include "tbprobe.h"
+
+/* Message types */
+#define MSG_SEARCH 1
+#define MSG_STOP 2
+#define MSG_DONE 3
+#define MSG_QUIT 4
+#define MSG_TT 5
+#define MSG_STATUS 6
+
+/* The minimum depth of transposition table entries that are shared */
+#define CLUSTER_SHARE_DEPTH 8
+
+/* The maximum number of entries sent in one message */
+#define CLUSTER_TT_BATCH_SIZE 1024
+
+/* Time between sending batched entries and status (in ms) */
+#define CLUSTER_POLL_INTERVAL 10
+
+/* Header of all messages */
+struct message_header {
+    uint32_t type;
+    uint32_t size;
+};
+
+/* Message sent by the master to start a search */
+struct search_message {
+    int32_t nthreads;
+    int32_t hash_size;
+    int32_t sd;
+    int32_t probe_tb;
+    struct position pos;
+};
+
+/*
+ * Message with the progress of a search. Sent by nodes with their own
+ * progress and by the master with the progress of the whole cluster.
+ */
+struct status_message {
+    int32_t depth;
+    int32_t padding;
+    uint64_t nodes;
+};
+
+/* A transposition table entry sent between processes */
+struct shared_entry {
+    uint64_t key;
+    uint32_t move;
+    int16_t score;
+    int16_t eval_score;
+    uint8_t depth;
+    uint8_t type;
+    uint8_t padding[6];
+};
+
+/* Buffer for receiving the data of a message */
+union message_data {
+    struct search_message search;
+    struct status_message status;
+    struct shared_entry entries[CLUSTER_TT_BATCH_SIZE];
+};
+
+/* The number of processes in the cluster, including the master */
+static int number_of_nodes = 1;
+
+/*
+ * Sockets and process ids of the nodes. On the master index 0 is unused,
+ * in a node process index 0 is the socket connected to the master.
+ */
+static int sockets[MAX_CLUSTER_NODES];
+static int pids[MAX_CLUSTER_NODES];
+static bool alive[MAX_CLUSTER_NODES];
+
+/* Flag indicating if transposition table entries should be shared */
+static atomic_bool sharing = false;
+
+/* Flag used to tell the communication thread to stop */
+static atomic_bool stop_comm = false;
+
+/* The highest depth completed in the cluster */
+static atomic_int cluster_depth = 0;
+
+/* The number of nodes searched by the other processes */
+static atomic_uint_least64_t remote_nodes[MAX_CLUSTER_NODES];
+
+/* Entries waiting to be sent to the other processes */
+static mutex_t tt_lock;
+static struct shared_entry tt_buffer[CLUSTER_TT_BATCH_SIZE];
+static int tt_buffer_size = 0;
+
+/* Data for the communication thread */
+static thread_t comm_thread;
+static struct gamestate *search_state = NULL;
+
+/* Buffer for received messages, only used by one thread at a time */
+static union message_data rx_data;
+
+#ifndef WINDOWS
+/*
+ * Send a message. The sockets are of the SOCK_SEQPACKET type so a message
+ * is always sent as a whole. If wait is false then the message is only
+ * sent if the peer has room for it, otherwise it is dropped.
+ *
+ * During a search the periodic messages are sent without waiting. A
+ * process that is blocked sending to a peer that is itself blocked
+ * sending would otherwise hang the search when both queues are full.
+ */
+static bool send_message(int fd, uint32_t type, void *data, uint32_t size,
+                         bool wait)
+{
+    struct message_header header;
+    struct iovec          iov[2];
+    struct msghdr         msg;
+    ssize_t               n;
+
+    header.type = type;
+    header.size = size;
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = data;
+    iov[1].iov_len = size;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (size > 0)?2:1;
+
+    do {
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL|(wait?0:MSG_DONTWAIT));
+    } while ((n < 0) && (errno == EINTR));
+
+    return n == (ssize_t)(sizeof(header)+size);
+}
+
+static bool receive_message(int fd, struct message_header *header)
+{
+    struct iovec  iov[2];
+    struct msghdr msg;
+    ssize_t       n;
+
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(*header);
+    iov[1].iov_base = &rx_data;
+    iov[1].iov_len = sizeof(rx_data);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    do {
+        n = recvmsg(fd, &msg, 0);
+    } while ((n < 0) && (errno == EINTR));
+
+    if ((n < (ssize_t)sizeof(*header)) || (msg.msg_flags&MSG_TRUNC)) {
+        return false;
+    }
+    return (header->size <= sizeof(rx_data)) &&
+           (n == (ssize_t)(sizeof(*header)+header->size));
+}
+
+static void store_entries(int nentries)
+{
+    struct shared_entry *entry;
+    int                 k;
+
+    for (k=0;k<nentries;k++) {
+        entry = &rx_data.entries[k];
+        hash_tt_store_shared(entry->key, entry->move, entry->depth,
+                             entry->score, entry->type, entry->eval_score);
+    }
+}
+
+static void update_depth(int depth)
+{
+    int current;
+
+    current = atomic_load(&cluster_depth);
+    while ((depth > current) &&
+           !atomic_compare_exchange_weak(&cluster_depth, &current, depth)) {
+        /* Retry with the updated value */
+    }
+}
+
+/*
+ * Take the entries that are waiting to be sent. The entries are copied
+ * so that the lock is not held while sending.
+ */
+static int take_entries(struct shared_entry *entries)
+{
+    int nentries;
+
+    mutex_lock(&tt_lock);
+    nentries = tt_buffer_size;
+    memcpy(entries, tt_buffer, nentries*sizeof(struct shared_entry));
+    tt_buffer_size = 0;
+    mutex_unlock(&tt_lock);
+
+    return nentries;
+}
+
+static thread_retval_t master_comm_func(void *data)
+{
+    static struct shared_entry entries[CLUSTER_TT_BATCH_SIZE];
+    struct pollfd              fds[MAX_CLUSTER_NODES];
+    struct message_header      header;
+    struct status_message      status;
+    bool                       done[MAX_CLUSTER_NODES];
+    bool                       stop_pending[MAX_CLUSTER_NODES];
+    bool                       stopping;
+    time_t                     last_flush;
+    int                        nentries;
+    int                        nwaiting;
+    int                        k;
+    int                        l;
+
+    (void)data;
+
+    nwaiting = 0;
+    for (k=1;k<number_of_nodes;k++) {
+        done[k] = !alive[k];
+        stop_pending[k] = false;
+        nwaiting += alive[k]?1:0;
+    }
+
+    stopping = false;
+    last_flush = 0;
+    while (nwaiting > 0) {
+        /*
+         * Tell all nodes to stop when the master is done. The stop
+         * message is retried until there is room for it.
+         */
+        if (!stopping && atomic_load(&stop_comm)) {
+            stopping = true;
+            atomic_store(&sharing, false);
+            for (k=1;k<number_of_nodes;k++) {
+                stop_pending[k] = true;
+            }
+        }
+        for (k=1;k<number_of_nodes;k++) {
+            if (stop_pending[k] && !done[k]) {
+                stop_pending[k] = !send_message(sockets[k], MSG_STOP, NULL,
+                                                0, false);
+            }
+        }
+
+        /* Send queued entries and the progress of the cluster */
+        if (!stopping &&
+            ((get_current_time()-last_flush) >= CLUSTER_POLL_INTERVAL)) {
+            last_flush = get_current_time();
+            nentries = take_entries(entries);
+            update_depth(search_state->completed_depth);
+            status.depth = atomic_load(&cluster_depth);
+            status.padding = 0;
+            status.nodes = 0ULL;
+            for (k=1;k<number_of_nodes;k++) {
+                if (done[k]) {
+                    continue;
+                }
+                if (nentries > 0) {
+                    (void)send_message(sockets[k], MSG_TT, entries,
+                                    nentries*sizeof(struct shared_entry),
+                                    false);
+                }
+                (void)send_message(sockets[k], MSG_STATUS, &status,
+                                   sizeof(status), false);
+            }
+        }
+
+        /* Wait for messages from the nodes */
+        for (k=1;k<number_of_nodes;k++) {
+            fds[k-1].fd = done[k]?-1:sockets[k];
+            fds[k-1].events = POLLIN|(stop_pending[k]?POLLOUT:0);
+            fds[k-1].revents = 0;
+        }
+        if (poll(fds, number_of_nodes-1, CLUSTER_POLL_INTERVAL) <= 0) {
+            continue;
+        }
+
+        for (k=1;k<number_of_nodes;k++) {
+            if (done[k] ||
+                ((fds[k-1].revents&(POLLIN|POLLHUP|POLLERR)) == 0)) {
+                continue;
+            }
+            if (!receive_message(sockets[k], &header)) {
+                /* The node has died, stop using it */
+                alive[k] = false;
+                done[k] = true;
+                nwaiting--;
+                continue;
+            }
+
+            switch (header.type) {
+            case MSG_TT:
+                nentries = header.size/sizeof(struct shared_entry);
+                store_entries(nentries);
+                if (stopping) {
+                    break;
+                }
+                for (l=1;l<number_of_nodes;l++) {
+                    if ((l != k) && !done[l]) {
+                        (void)send_message(sockets[l], MSG_TT, &rx_data,
+                                           header.size, false);
+                    }
+                }
+                break;
+            case MSG_STATUS:
+                update_depth(rx_data.status.depth);
+                atomic_store(&remote_nodes[k], rx_data.status.nodes);
+                break;
+            case MSG_DONE:
+                done[k] = true;
+                nwaiting--;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    return (thread_retval_t)0;
+}
+
+static thread_retval_t node_comm_func(void *data)
+{
+    static struct shared_entry entries[CLUSTER_TT_BATCH_SIZE];
+    struct pollfd              fds;
+    struct message_header      header;
+    struct status_message      status;
+    bool                       stop_received;
+    time_t                     last_flush;
+    int                        nentries;
+
+    (void)data;
+
+    stop_received = false;
+    last_flush = 0;
+    while (!atomic_load(&stop_comm)) {
+        /*
+         * The stop message can arrive before the search has started
+         * in which case the stop flag is cleared again when the search
+         * starts. Therefore the stop is repeated until the search ends.
+         */
+        if (stop_received) {
+            smp_stop_all();
+        }
+
+        /* Send queued entries and the progress of this node */
+        if ((get_current_time()-last_flush) >= CLUSTER_POLL_INTERVAL) {
+            last_flush = get_current_time();
+            nentries = take_entries(entries);
+            if (nentries > 0) {
+                (void)send_message(sockets[0], MSG_TT, entries,
+                                   nentries*sizeof(struct shared_entry),
+                                   false);
+            }
+            status.depth = search_state->completed_depth;
+            status.padding = 0;
+            status.nodes = smp_nodes();
+            (void)send_message(sockets[0], MSG_STATUS, &status,
+                               sizeof(status), false);
+        }
+
+        /* Wait for messages from the master */
+        fds.fd = sockets[0];
+        fds.events = POLLIN;
+        fds.revents = 0;
+        if (poll(&fds, 1, CLUSTER_POLL_INTERVAL) <= 0) {
+            continue;
+        }
+        if (!receive_message(sockets[0], &header)) {
+            /* The master is gone so there is no point searching */
+            stop_received = true;
+            smp_stop_all();
+            break;
+        }
+
+        switch (header.type) {
+        case MSG_STOP:
+            stop_received = true;
+            smp_stop_all();
+            break;
+        case MSG_TT:
+            store_entries(header.size/sizeof(struct shared_entry));
+            break;
+        case MSG_STATUS:
+            update_depth(rx_data.status.depth);
+            break;
+        default:
+            break;
+        }
+    }
+
+    return (thread_retval_t)0;
+}
+
+static bool spawn_node(int idx)
+{
+    int  sv[2];
+    int  devnull;
+    int  pid;
+    char fdstr[16];
+
+    /*
+     * The sockets are created with close-on-exec so that nodes started
+     * later don't inherit the master side of the earlier nodes. The
+     * node side is made inheritable again in the child.
+     */
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, sv) != 0) {
+        return false;
+    }
+    sprintf(fdstr, "%d", sv[1]);
+
+    pid = fork();
+    if (pid < 0) {
+        close(sv[0]);
+        close(sv[1]);
+        return false;
+    } else if (pid == 0) {
+        /*
+         * Start a copy of the engine. The node must not use the
+         * connection to the GUI so stdin and stdout are redirected.
+         */
+        close(sv[0]);
+        (void)fcntl(sv[1], F_SETFD, 0);
+        devnull = open("/dev/null", O_RDWR);
+        if (devnull >= 0) {
+            dup2(devnull, 0);
+            dup2(devnull, 1);
+        }
+        execl("/proc/self/exe", "marvin", "--cluster-node", fdstr,
+              (char*)NULL);
+        _exit(1);
+    }
+
+    close(sv[1]);
+    sockets[idx] = sv[0];
+    pids[idx] = pid;
+    alive[idx] = true;
+
+    return true;
+}
+#endif
+
+void cluster_init(void)
+{
+    mutex_init(&tt_lock);
+}
+
+void cluster_destroy(void)
+{
+    cluster_stop_nodes();
+    mutex_destroy(&tt_lock);
+}
+
+bool cluster_start_nodes(int nnodes)
+{
+#ifndef WINDOWS
+    int k;
+
+    assert((nnodes >= 1) && (nnodes <= MAX_CLUSTER_NODES));
+
+    cluster_stop_nodes();
+    for (k=1;k<nnodes;k++) {
+        if (!spawn_node(k)) {
+            number_of_nodes = k;
+            cluster_stop_nodes();
+            return false;
+        }
+        number_of_nodes = k + 1;
+    }
+
+    return true;
+#else
+    (void)nnodes;
+    return false;
+#endif
+}
+
+void cluster_stop_nodes(void)
+{
+#ifndef WINDOWS
+    int k;
+
+    for (k=1;k<number_of_nodes;k++) {
+        if (alive[k]) {
+            (void)send_message(sockets[k], MSG_QUIT, NULL, 0, true);
+        }
+        close(sockets[k]);
+        waitpid(pids[k], NULL, 0);
+        alive[k] = false;
+    }
+#endif
+    number_of_nodes = 1;
+}
+
+int cluster_number_of_nodes(void)
+{
+    return number_of_nodes;
+}
+
+void cluster_start_search(struct gamestate *state)
+{
+#ifndef WINDOWS
+    struct search_message *msg;
+    int                   k;
+
+    assert(number_of_nodes > 1);
+
+    msg = calloc(1, sizeof(struct search_message));
+    if (msg == NULL) {
+        return;
+    }
+    msg->nthreads = smp_number_of_workers();
+    msg->hash_size = hash_tt_size();
+    msg->sd = state->sd;
+    msg->probe_tb = state->probe_wdl;
+    board_copy(&msg->pos, &state->pos);
+
+    for (k=1;k<number_of_nodes;k++) {
+        atomic_store(&remote_nodes[k], 0ULL);
+        if (alive[k] && !send_message(sockets[k], MSG_SEARCH, msg,
+                                      sizeof(struct search_message), true)) {
+            alive[k] = false;
+        }
+    }
+    free(msg);
+
+    tt_buffer_size = 0;
+    search_state = state;
+    atomic_store(&cluster_depth, 0);
+    atomic_store(&stop_comm, false);
+    atomic_store(&sharing, true);
+    thread_create(&comm_thread, (thread_func_t)master_comm_func, NULL);
+#else
+    (void)state;
+#endif
+}
+
+void cluster_stop_search(void)
+{
+#ifndef WINDOWS
+    atomic_store(&stop_comm, true);
+    thread_join(&comm_thread);
+    atomic_store(&sharing, false);
+    atomic_store(&cluster_depth, 0);
+    search_state = NULL;
+#endif
+}
+
+uint64_t cluster_nodes(void)
+{
+    uint64_t nodes;
+    int      k;
+
+    nodes = 0ULL;
+    for (k=1;k<number_of_nodes;k++) {
+        nodes += atomic_load_explicit(&remote_nodes[k], memory_order_relaxed);
+    }
+    return nodes;
+}
+
+int cluster_completed_depth(void)
+{
+    return atomic_load_explicit(&cluster_depth, memory_order_relaxed);
+}
+
+void cluster_share_tt_entry(uint64_t key, uint32_t move, int depth,
+                            int score, int type, int eval_score)
+{
+    struct shared_entry *entry;
+
+    if ((depth < CLUSTER_SHARE_DEPTH) ||
+        !atomic_load_explicit(&sharing, memory_order_relaxed)) {
+        return;
+    }
+
+    /*
+     * If the buffer is full then the entry is dropped. Sharing
+     * entries only helps the other processes so that is harmless.
+     */
+    mutex_lock(&tt_lock);
+    if (tt_buffer_size < CLUSTER_TT_BATCH_SIZE) {
+        entry = &tt_buffer[tt_buffer_size++];
+        memset(entry, 0, sizeof(struct shared_entry));
+        entry->key = key;
+        entry->move = move;
+        entry->score = (int16_t)score;
+        entry->eval_score = (int16_t)eval_score;
+        entry->depth = (uint8_t)depth;
+        entry->type = (uint8_t)type;
+    }
+    mutex_unlock(&tt_lock);
+}
+
+void cluster_node_loop(int fd)
+{
+#ifndef WINDOWS
+    struct gamestate      *state;
+    struct message_header header;
+    int                   hash_size;
+    bool                  probe_tb;
+
+    state = create_game_state();
+    if (state == NULL) {
+        return;
+    }
+    sockets[0] = fd;
+
+    while (receive_message(fd, &header)) {
+        if (header.type == MSG_QUIT) {
+            break;
+        } else if (header.type != MSG_SEARCH) {
+            /* Left over messages from the previous search */
+            continue;
+        }
+
+        /* Use the same configuration as the master */
+        if (rx_data.search.nthreads != smp_number_of_workers()) {
+            smp_destroy_workers();
+            smp_create_workers(CLAMP(rx_data.search.nthreads, 1,
+                                     MAX_WORKERS));
+        }
+        hash_size = CLAMP(rx_data.search.hash_size, MIN_MAIN_HASH_SIZE,
+                          hash_tt_max_size());
+        if (hash_size != hash_tt_size()) {
+            hash_tt_create_table(hash_size);
+        }
+
+        /* Setup the search */
+        board_copy(&state->pos, &rx_data.search.pos);
+        state->sd = rx_data.search.sd;
+        state->silent = true;
+        state->move_filter.size = 0;
+        state->exit_on_mate = false;
+        state->multipv = 1;
+        probe_tb = (rx_data.search.probe_tb != 0) && (TB_LARGEST > 0);
+        tc_configure_time_control(0, 0, 0, TC_INFINITE_TIME);
+
+        /* Search until the master says stop */
+        tt_buffer_size = 0;
+        search_state = state;
+        atomic_store(&cluster_depth, 0);
+        atomic_store(&stop_comm, false);
+        atomic_store(&sharing, true);
+        thread_create(&comm_thread, (thread_func_t)node_comm_func, NULL);
+        smp_search(state, false, false, probe_tb);
+        atomic_store(&sharing, false);
+        atomic_store(&stop_comm, true);
+        thread_join(&comm_thread);
+        search_state = NULL;
+
+        if (!send_message(fd, MSG_DONE, NULL, 0, true)) {
+            break;
+        }
+    }
+
+    close(fd);
+    destroy_game_state(state);
+#else
+    (void)fd;
+#endif
+}
@@ -0,0 +1,110 @@
+/*
+ * Marvin - an UCI/XBoard compatible chess engine
+ * Copyright (C) 2015 Martin Danielsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "chess.h"
+
+/* The maximum number of processes in a cluster, including the master */
+#define MAX_CLUSTER_NODES 64
+
+/* Initialize the cluster component */
+void cluster_init(void);
+
+/* Clean up the cluster component. Any running nodes are stopped. */
+void cluster_destroy(void);
+
+/*
+ * Start a cluster of processes. The calling process becomes the master
+ * and the other processes are started as copies of the running
+ * executable. They are connected to the master using Unix domain
+ * sockets. Any existing cluster is stopped first.
+ *
+ * @param nnodes The total number of processes, including the master.
+ *               A value of 1 disables the cluster.
+ * @return Returns true if all processes were started.
+ */
+bool cluster_start_nodes(int nnodes);
+
+/* Stop all processes in the cluster */
+void cluster_stop_nodes(void);
+
+/*
+ * Get the number of processes in the cluster.
+ *
+ * @return Returns the number of processes, including the master.
+ */
+int cluster_number_of_nodes(void);
+
+/*
+ * Start a search in all processes of the cluster. Called by the master
+ * when its own workers are started.
+ *
+ * @param state The game state of the search.
+ */
+void cluster_start_search(struct gamestate *state);
+
+/*
+ * Stop the search in all processes of the cluster and wait for
+ * them to finish.
+ */
+void cluster_stop_search(void);
+
+/*
+ * Get the number of nodes searched by the other processes in the
+ * cluster during the current search.
+ *
+ * @return Returns the number of nodes.
+ */
+uint64_t cluster_nodes(void);
+
+/*
+ * Get the highest depth completed by any process in the cluster
+ * during the current search.
+ *
+ * @return Returns the depth, or 0 if no cluster search is active.
+ */
+int cluster_completed_depth(void);
+
+/*
+ * Queue an entry from the main transposition table to be sent to the
+ * other processes in the cluster. Only entries with a high depth are
+ * shared and nothing is done if no cluster search is active.
+ *
+ * @param key The key of the position.
+ * @param move The best move found.
+ * @param depth The depth to which the position was searched.
+ * @param score The score, adjusted as stored in the table.
+ * @param type The type of the score.
+ * @param eval_score The static evaluation of the position.
+ */
+void cluster_share_tt_entry(uint64_t key, uint32_t move, int depth,
+                            int score, int type, int eval_score);
+
+/*
+ * Run a process as a cluster node. Searches are received from the
+ * master until the master quits.
+ *
+ * @param fd The socket connected to the master.
+ */
+void cluster_node_loop(int fd);
+
+#endif
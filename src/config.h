@@ -35,8 +35,13 @@
 #define MAX_MAIN_HASH_SIZE_32BIT 1024
 #define MAX_MAIN_HASH_SIZE_64BIT 131072
 
-/* The size to use for the pawn hash tables (in MB) */
+/*
+ * The size to use for the pawn hash tables (in MB). This value
+ * can be configured at runtime by using the UCI PawnHash option.
+ */
 #define PAWN_HASH_SIZE 2
+#define MIN_PAWN_HASH_SIZE 1
+#define MAX_PAWN_HASH_SIZE 1024
 
 /* The maximum number of supported worker threads */
 #define MAX_WORKERS 512
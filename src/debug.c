@@ -282,6 +282,59 @@ void dbg_print_movelist(struct movelist *list)
     printf("\n");
 }
 
+static void print_stats_percent(uint64_t count, uint64_t total)
+{
+    if (total > 0) {
+        printf(" %6.1f", (100.0*count)/total);
+    } else {
+        printf(" %6s", "-");
+    }
+}
+
+static void print_stats_row(char *label, uint64_t *row)
+{
+    printf("%-5s %10"PRIu64, label, row[SSTAT_NODES]);
+    print_stats_percent(row[SSTAT_TT_HITS], row[SSTAT_TT_PROBES]);
+    print_stats_percent(row[SSTAT_TT_CUTOFFS], row[SSTAT_TT_PROBES]);
+    printf(" %8"PRIu64, row[SSTAT_RFP_PRUNES]);
+    print_stats_percent(row[SSTAT_RAZOR_CUTOFFS], row[SSTAT_RAZOR_TRIES]);
+    print_stats_percent(row[SSTAT_NULL_CUTOFFS], row[SSTAT_NULL_TRIES]);
+    print_stats_percent(row[SSTAT_PROBCUT_CUTOFFS], row[SSTAT_PROBCUT_TRIES]);
+    print_stats_percent(row[SSTAT_SE_EXTENSIONS], row[SSTAT_SE_TRIES]);
+    printf(" %9"PRIu64" %9"PRIu64" %9"PRIu64" %9"PRIu64,
+           row[SSTAT_FUTILITY_PRUNES], row[SSTAT_LMP_PRUNES],
+           row[SSTAT_SEE_PRUNES], row[SSTAT_HISTORY_PRUNES]);
+    print_stats_percent(row[SSTAT_LMR_RESEARCHES], row[SSTAT_LMR_SEARCHES]);
+    print_stats_percent(row[SSTAT_FIRST_MOVE_FAIL_HIGHS],
+                        row[SSTAT_FAIL_HIGHS]);
+    printf("\n");
+}
+
+void dbg_print_search_stats(uint64_t stats[MAX_SEARCH_DEPTH][NSEARCHSTATS])
+{
+    uint64_t total[NSEARCHSTATS];
+    char     label[8];
+    int      depth;
+    int      k;
+
+    printf("%-5s %10s %6s %6s %8s %6s %6s %6s %6s %9s %9s %9s %9s %6s %6s\n",
+           "depth", "nodes", "tthit", "ttcut", "rfp", "razor", "null",
+           "pcut", "se", "futility", "lmp", "see", "history", "lmr",
+           "fh1");
+    memset(total, 0, sizeof(total));
+    for (depth=0;depth<MAX_SEARCH_DEPTH;depth++) {
+        if (stats[depth][SSTAT_NODES] == 0ULL) {
+            continue;
+        }
+        for (k=0;k<NSEARCHSTATS;k++) {
+            total[k] += stats[depth][k];
+        }
+        sprintf(label, "%d", depth);
+        print_stats_row(label, stats[depth]);
+    }
+    print_stats_row("total", total);
+}
+
 void dbg_browse_transposition_table(struct position *pos)
 {
     bool            stop;
@@ -83,6 +83,14 @@ void dbg_print_move(uint32_t move);
  */
 void dbg_print_movelist(struct movelist *list);
 
+/*
+ * Print a table with search statistics broken down by remaining depth.
+ * Success rates are printed as percentages of the number of tries.
+ *
+ * @param stats The search statistics counters.
+ */
+void dbg_print_search_stats(uint64_t stats[MAX_SEARCH_DEPTH][NSEARCHSTATS]);
+
 /*
  * Interactivly browse the trasposition table.
  *
@@ -36,6 +36,7 @@
 #include "thread.h"
 #include "smp.h"
 #include "board.h"
+#include "hash.h"
 
 /* Size of the receive buffer */
 #define RX_BUFFER_SIZE 4096
@@ -47,7 +48,20 @@
 enum protocol engine_protocol = PROTOCOL_UNSPECIFIED;
 char engine_syzygy_path[MAX_PATH_LENGTH+1] = {'\0'};
 int engine_default_hash_size = DEFAULT_MAIN_HASH_SIZE;
+bool engine_default_large_pages = true;
 int engine_default_num_threads = 1;
+bool engine_default_numa_bind = false;
+char engine_default_cpu_affinity[MAX_CPU_AFFINITY_LENGTH+1] = "none";
+bool engine_default_avoid_smt = true;
+char engine_default_depth_pattern[MAX_DEPTH_PATTERN_LENGTH+1] = "half";
+char engine_default_smp_mode[MAX_SMP_MODE_LENGTH+1] = "lazy";
+int engine_default_cluster_nodes = 1;
+bool engine_default_parallel_multipv = false;
+int engine_default_pawn_hash_size = PAWN_HASH_SIZE;
+bool engine_default_shared_pawn_hash = false;
+char engine_hash_file[MAX_PATH_LENGTH+1] = {'\0'};
+bool engine_load_hash_on_startup = false;
+bool engine_save_hash_on_exit = false;
 
 /* Buffer used for receiving commands */
 static char rx_buffer[RX_BUFFER_SIZE+1];
@@ -119,6 +133,60 @@ static void cmd_eval(struct gamestate *state)
     printf("Score: %d (for white)\n", state->pos.stm == WHITE?score:-score);
 }
 
+/*
+ * Get the file argument of a hash file command. If no file is
+ * specified then the configured hash file is used.
+ */
+static char* hash_file_argument(char *cmd)
+{
+    char *iter;
+
+    iter = strchr(cmd, ' ');
+    if (iter != NULL) {
+        iter = skip_whitespace(iter);
+        if (*iter != '\0') {
+            return iter;
+        }
+    }
+    return (engine_hash_file[0] != '\0')?engine_hash_file:NULL;
+}
+
+/*
+ * Custom command
+ * Syntax: loadhash [<file>]
+ */
+static void cmd_loadhash(char *cmd)
+{
+    char *file;
+
+    file = hash_file_argument(cmd);
+    if (file == NULL) {
+        printf("No hash file specified\n");
+    } else if (hash_tt_load(file)) {
+        printf("Hash table loaded from %s\n", file);
+    } else {
+        printf("Failed to load hash table from %s\n", file);
+    }
+}
+
+/*
+ * Custom command
+ * Syntax: savehash [<file>]
+ */
+static void cmd_savehash(char *cmd)
+{
+    char *file;
+
+    file = hash_file_argument(cmd);
+    if (file == NULL) {
+        printf("No hash file specified\n");
+    } else if (hash_tt_save(file)) {
+        printf("Hash table saved to %s\n", file);
+    } else {
+        printf("Failed to save hash table to %s\n", file);
+    }
+}
+
 /*
  * Custom command
  * Syntax: perft <depth>
@@ -141,6 +209,21 @@ static void cmd_perft(char *cmd, struct gamestate *state)
     test_run_perft(&state->pos, depth);
 }
 
+/*
+ * Custom command
+ * Syntax: stats
+ */
+static void cmd_stats(void)
+{
+    static uint64_t stats[MAX_SEARCH_DEPTH][NSEARCHSTATS];
+
+    if (!smp_search_statistics(stats)) {
+        printf("Search statistics are not available, build with stats=yes\n");
+        return;
+    }
+    dbg_print_search_stats(stats);
+}
+
 /*
  * Custom command
  * Syntax: quiet
@@ -153,7 +236,7 @@ static void cmd_quiet(struct gamestate *state)
     char            movestr[MAX_MOVESTR_LENGTH];
 
     pv.size = 0;
-    pos = state->pos;
+    board_copy(&pos, &state->pos);
     board_quiet(&pos, &pv);
 
     printf("pv");
@@ -196,10 +279,16 @@ void engine_loop(struct gamestate *state)
             cmd_divide(cmd, state);
         } else if (!strncmp(cmd, "eval", 4)) {
             cmd_eval(state);
+        } else if (!strncmp(cmd, "loadhash", 8)) {
+            cmd_loadhash(cmd);
         } else if (!strncmp(cmd, "perft", 5)) {
             cmd_perft(cmd, state);
         } else if (!strncmp(cmd, "quiet", 5)) {
             cmd_quiet(state);
+        } else if (!strncmp(cmd, "savehash", 8)) {
+            cmd_savehash(cmd);
+        } else if (!strncmp(cmd, "stats", 5)) {
+            cmd_stats();
         } else {
             handled = false;
         }
@@ -346,3 +435,26 @@ void engine_send_multipv_info(struct search_worker *worker)
         uci_send_multipv_info(worker);
     }
 }
+
+void engine_send_selection_info(struct search_worker *worker, int64_t votes,
+                                int64_t total, char *reason)
+{
+    if (worker->state->silent) {
+        return;
+    }
+
+    if (engine_protocol == PROTOCOL_UCI) {
+        uci_send_selection_info(worker, votes, total, reason);
+    }
+}
+
+void engine_send_search_stats(struct search_worker *worker)
+{
+    if (worker->state->silent) {
+        return;
+    }
+
+    if (engine_protocol == PROTOCOL_UCI) {
+        uci_send_search_stats();
+    }
+}
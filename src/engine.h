@@ -25,6 +25,15 @@
 /* Maximum length accepted for file paths */
 #define MAX_PATH_LENGTH 1024
 
+/* Maximum length of a CPU affinity specification */
+#define MAX_CPU_AFFINITY_LENGTH 255
+
+/* Maximum length of the name of a SMP depth pattern */
+#define MAX_DEPTH_PATTERN_LENGTH 15
+
+/* Maximum length of the name of a SMP algorithm */
+#define MAX_SMP_MODE_LENGTH 15
+
 /* Enum for different chess protocols */
 enum protocol {
     PROTOCOL_UNSPECIFIED,
@@ -36,7 +45,20 @@ enum protocol {
 extern enum protocol engine_protocol;
 extern char engine_syzygy_path[MAX_PATH_LENGTH+1];
 extern int engine_default_hash_size;
+extern bool engine_default_large_pages;
 extern int engine_default_num_threads;
+extern bool engine_default_numa_bind;
+extern char engine_default_cpu_affinity[MAX_CPU_AFFINITY_LENGTH+1];
+extern bool engine_default_avoid_smt;
+extern char engine_default_depth_pattern[MAX_DEPTH_PATTERN_LENGTH+1];
+extern char engine_default_smp_mode[MAX_SMP_MODE_LENGTH+1];
+extern int engine_default_cluster_nodes;
+extern bool engine_default_parallel_multipv;
+extern int engine_default_pawn_hash_size;
+extern bool engine_default_shared_pawn_hash;
+extern char engine_hash_file[MAX_PATH_LENGTH+1];
+extern bool engine_load_hash_on_startup;
+extern bool engine_save_hash_on_exit;
 
 /*
  * The main engine loop.
@@ -124,4 +146,23 @@ void engine_send_move_info(struct search_worker *worker);
  */
 void engine_send_multipv_info(struct search_worker *worker);
 
+/*
+ * Send information about which worker that was selected to provide
+ * the best move at the end of a parallel search.
+ *
+ * @param worker The selected worker.
+ * @param votes The number of votes for the selected move.
+ * @param total The total number of votes.
+ * @param reason The reason the worker was selected.
+ */
+void engine_send_selection_info(struct search_worker *worker, int64_t votes,
+                                int64_t total, char *reason);
+
+/*
+ * Send a summary of the search statistics at the end of a search.
+ *
+ * @param worker The master worker.
+ */
+void engine_send_search_stats(struct search_worker *worker);
+
 #endif
@@ -25,6 +25,7 @@
 #include "validation.h"
 #include "bitboard.h"
 #include "hash.h"
+#include "key.h"
 #include "fen.h"
 #include "utils.h"
 #include "debug.h"
@@ -49,6 +50,7 @@
 struct eval {
     bool in_pawntt;
     struct pawntt_item pawntt;
+    struct materialtt_item material;
     bool endgame[NSIDES];
     uint64_t attacked_by[NPIECES];
     uint64_t attacked[NSIDES];
@@ -572,6 +574,148 @@ static void evaluate_passers(struct position *pos, struct eval *eval)
     }
 }
 
+/*
+ * The following combination of pieces can never lead to chekmate:
+ * - King vs King
+ * - King+Knight vs King
+ * - King+Bishops vs King (if the bishops operate on the same color squares)
+ *
+ * The last case depends on the location of the bishops so it is
+ * only flagged here and has to be checked separately.
+ */
+static int material_draw_flags(uint64_t key)
+{
+    int wb;
+    int wn;
+    int bb;
+    int bn;
+
+    if ((MATERIALKEY_COUNT(key, WHITE_PAWN) != 0) ||
+        (MATERIALKEY_COUNT(key, BLACK_PAWN) != 0) ||
+        (MATERIALKEY_COUNT(key, WHITE_ROOK) != 0) ||
+        (MATERIALKEY_COUNT(key, BLACK_ROOK) != 0) ||
+        (MATERIALKEY_COUNT(key, WHITE_QUEEN) != 0) ||
+        (MATERIALKEY_COUNT(key, BLACK_QUEEN) != 0)) {
+        return 0;
+    }
+
+    wn = MATERIALKEY_COUNT(key, WHITE_KNIGHT);
+    bn = MATERIALKEY_COUNT(key, BLACK_KNIGHT);
+    wb = MATERIALKEY_COUNT(key, WHITE_BISHOP);
+    bb = MATERIALKEY_COUNT(key, BLACK_BISHOP);
+
+    /* King vs King */
+    if ((wn == 0) && (bn == 0) && (wb == 0) && (bb == 0)) {
+        return MATERIAL_DRAW;
+    }
+    /* Knight+King vs King and King vs King+Knight */
+    if (((wn+bn) == 1) && (wb == 0) && (bb == 0)) {
+        return MATERIAL_DRAW;
+    }
+    /* King+Bishops vs King and King vs King+Bishops */
+    if ((wn == 0) && (bn == 0) && ((wb == 0) || (bb == 0))) {
+        return MATERIAL_BISHOPS_ONLY;
+    }
+
+    return 0;
+}
+
+static bool is_material_draw(struct position *pos, int flags)
+{
+    uint64_t bishops;
+
+    if (flags&MATERIAL_DRAW) {
+        return true;
+    }
+
+    /*
+     * Only one side have bishops left so all bishops on
+     * the board can be checked at the same time.
+     */
+    if (flags&MATERIAL_BISHOPS_ONLY) {
+        bishops = pos->bb_pieces[WHITE_BISHOP]|pos->bb_pieces[BLACK_BISHOP];
+        return ((bishops&white_square_mask) == 0ULL) ||
+               ((bishops&black_square_mask) == 0ULL);
+    }
+
+    return false;
+}
+
+/*
+ * Calculate all terms that only depend on the material of the position.
+ * The result is stored in the material transposition table so the
+ * calculation is only done once for each material distribution.
+ */
+static void calculate_material(struct position *pos, struct eval *eval)
+{
+    struct materialtt_item *item = &eval->material;
+    uint64_t               key;
+    int                    nknights;
+    int                    nbishops;
+    int                    nrooks;
+    int                    nqueens;
+    int                    side;
+    int                    score[NPHASES];
+
+    key = pos->materialkey;
+    memset(item, 0, sizeof(struct materialtt_item));
+
+    for (side=0;side<NSIDES;side++) {
+        nknights = MATERIALKEY_COUNT(key, KNIGHT+side);
+        nbishops = MATERIALKEY_COUNT(key, BISHOP+side);
+        nrooks = MATERIALKEY_COUNT(key, ROOK+side);
+        nqueens = MATERIALKEY_COUNT(key, QUEEN+side);
+
+        /* Material */
+        score[MIDDLEGAME] = nknights*KNIGHT_MATERIAL_VALUE_MG +
+                            nbishops*BISHOP_MATERIAL_VALUE_MG +
+                            nrooks*ROOK_MATERIAL_VALUE_MG +
+                            nqueens*QUEEN_MATERIAL_VALUE_MG;
+        score[ENDGAME] = nknights*KNIGHT_MATERIAL_VALUE_EG +
+                         nbishops*BISHOP_MATERIAL_VALUE_EG +
+                         nrooks*ROOK_MATERIAL_VALUE_EG +
+                         nqueens*QUEEN_MATERIAL_VALUE_EG;
+        TRACE_M(KNIGHT_MATERIAL_VALUE_MG, KNIGHT_MATERIAL_VALUE_EG, nknights);
+        TRACE_M(BISHOP_MATERIAL_VALUE_MG, BISHOP_MATERIAL_VALUE_EG, nbishops);
+        TRACE_M(ROOK_MATERIAL_VALUE_MG, ROOK_MATERIAL_VALUE_EG, nrooks);
+        TRACE_M(QUEEN_MATERIAL_VALUE_MG, QUEEN_MATERIAL_VALUE_EG, nqueens);
+
+        /*
+         * Check if both bishops are still on the board. To be correct
+         * also check if the two (or more) bishops operate on different
+         * color squares. The only case when a player can have
+         * two bishops on the same color squares is if he underpromotes
+         * to a bishop. This is so unlikely that it should be safe to assume
+         * that the bishops operate on different color squares.
+         */
+        if (nbishops >= 2) {
+            score[MIDDLEGAME] += BISHOP_PAIR_MG;
+            score[ENDGAME] += BISHOP_PAIR_EG;
+            TRACE_M(BISHOP_PAIR_MG, BISHOP_PAIR_EG, 1);
+        }
+
+        item->score[MIDDLEGAME][side] = score[MIDDLEGAME];
+        item->score[ENDGAME][side] = score[ENDGAME];
+    }
+
+    /* Game phase and draw flags */
+    item->phase = eval_game_phase(pos);
+    item->flags = material_draw_flags(key);
+}
+
+static void evaluate_material(struct position *pos, struct eval *eval)
+{
+    if ((pos->worker != NULL) &&
+        hash_materialtt_lookup(pos->worker, &eval->material)) {
+        return;
+    }
+
+    calculate_material(pos, eval);
+    if (pos->worker != NULL) {
+        hash_materialtt_store(pos->worker, &eval->material);
+    }
+}
+
 static void evaluate_knights(struct position *pos, struct eval *eval)
 {
     uint64_t pieces;
@@ -594,11 +738,6 @@ static void evaluate_knights(struct position *pos, struct eval *eval)
         attacks = moves;
         moves &= (~pos->bb_sides[side]);
 
-        /* Material */
-        eval->score[MIDDLEGAME][side] += KNIGHT_MATERIAL_VALUE_MG;
-        eval->score[ENDGAME][side] += KNIGHT_MATERIAL_VALUE_EG;
-        TRACE_M(KNIGHT_MATERIAL_VALUE_MG, KNIGHT_MATERIAL_VALUE_EG, 1);
-
         /* Piece/square tables */
         index = (side == BLACK)?MIRROR(sq):sq;
         eval->score[MIDDLEGAME][side] += PSQ_TABLE_KNIGHT_MG[index];
@@ -648,22 +787,6 @@ static void evaluate_bishops(struct position *pos, struct eval *eval)
     int      side;
     int      opp_side;
 
-    /*
-     * Check if both bishops are still on the board. To be correct
-     * also check if the two (or more) bishops operate on different
-     * color squares. The only case when a player can have
-     * two bishops on the same color squares is if he underpromotes
-     * to a bishop. This is so unlikely that it should be safe to assume
-     * that the bishops operate on different color squares.
-     */
-    for (side=0;side<NSIDES;side++) {
-        if (BITCOUNT(pos->bb_pieces[side+BISHOP]) >= 2) {
-            eval->score[MIDDLEGAME][side] += BISHOP_PAIR_MG;
-            eval->score[ENDGAME][side] += BISHOP_PAIR_EG;
-            TRACE_M(BISHOP_PAIR_MG, BISHOP_PAIR_EG, 1);
-        }
-    }
-
     pieces = pos->bb_pieces[WHITE_BISHOP]|pos->bb_pieces[BLACK_BISHOP];
     while (pieces != 0ULL) {
         sq = POPBIT(&pieces);
@@ -674,11 +797,6 @@ static void evaluate_bishops(struct position *pos, struct eval *eval)
         attacks = moves;
         moves &= (~pos->bb_sides[side]);
 
-        /* Material */
-        eval->score[MIDDLEGAME][side] += BISHOP_MATERIAL_VALUE_MG;
-        eval->score[ENDGAME][side] += BISHOP_MATERIAL_VALUE_EG;
-        TRACE_M(BISHOP_MATERIAL_VALUE_MG, BISHOP_MATERIAL_VALUE_EG, 1);
-
         /* Piece/square tables */
         index = (side == BLACK)?MIRROR(sq):sq;
         eval->score[MIDDLEGAME][side] += PSQ_TABLE_BISHOP_MG[index];
@@ -733,11 +851,6 @@ static void evaluate_rooks(struct position *pos, struct eval *eval)
         attacks = moves;
         moves &= (~pos->bb_sides[side]);
 
-        /* Material */
-        eval->score[MIDDLEGAME][side] += ROOK_MATERIAL_VALUE_MG;
-        eval->score[ENDGAME][side] += ROOK_MATERIAL_VALUE_EG;
-        TRACE_M(ROOK_MATERIAL_VALUE_MG, ROOK_MATERIAL_VALUE_EG, 1);
-
         /* Piece/square tables */
         index = (side == BLACK)?MIRROR(sq):sq;
         eval->score[MIDDLEGAME][side] += PSQ_TABLE_ROOK_MG[index];
@@ -819,11 +932,6 @@ static void evaluate_queens(struct position *pos, struct eval *eval)
                  eval->attacked_by[BISHOP+opp_side]|
                  eval->attacked_by[ROOK+opp_side];
 
-        /* Material */
-        eval->score[MIDDLEGAME][side] += QUEEN_MATERIAL_VALUE_MG;
-        eval->score[ENDGAME][side] += QUEEN_MATERIAL_VALUE_EG;
-        TRACE_M(QUEEN_MATERIAL_VALUE_MG, QUEEN_MATERIAL_VALUE_EG, 1);
-
         /* Piece/square tables */
         index = (side == BLACK)?MIRROR(sq):sq;
         eval->score[MIDDLEGAME][side] += PSQ_TABLE_QUEEN_MG[index];
@@ -931,8 +1039,6 @@ static void do_eval(struct position *pos, struct eval *eval)
 {
     int k;
 
-    memset(eval, 0, sizeof(struct eval));
-
     /* Init attack table */
     init_attack_tables(pos, eval);
 
@@ -972,101 +1078,82 @@ static void do_eval(struct position *pos, struct eval *eval)
         eval->score[k][BLACK] += eval->pawntt.score[k][BLACK];
     }
 
+    /* Add material terms */
+    for (k=0;k<NPHASES;k++) {
+        eval->score[k][WHITE] += eval->material.score[k][WHITE];
+        eval->score[k][BLACK] += eval->material.score[k][BLACK];
+    }
+
     /* Update the pawn hash table */
     if (!eval->in_pawntt && (pos->worker != NULL)) {
         hash_pawntt_store(pos->worker, &eval->pawntt);
     }
 }
 
-int eval_evaluate(struct position *pos)
+static int evaluate(struct position *pos)
 {
     struct eval eval;
     int         k;
-    int         phase;
     int         score[NPHASES];
     int         tapered_score;
 
-    assert(valid_position(pos));
+    memset(&eval, 0, sizeof(struct eval));
+
+    /* Lookup material related information */
+    evaluate_material(pos, &eval);
 
     /*
      * If no player have enough material left
      * to checkmate then it's a draw.
      */
-    if (eval_is_material_draw(pos)) {
+    if (is_material_draw(pos, eval.material.flags)) {
         return 0;
     }
 
     /* Evaluate the position */
     do_eval(pos, &eval);
 
-    /* Summarize each evaluation term from side to moves's pov */
+    /* Summarize each evaluation term from white's pov */
     for (k=0;k<NPHASES;k++) {
-        score[k] = 0;
-
-        score[k] += eval.score[k][WHITE];
-        score[k] -= eval.score[k][BLACK];
+        score[k] = eval.score[k][WHITE] - eval.score[k][BLACK];
+    }
 
+    /* Adjust the scores to the side to move's pov */
+    for (k=0;k<NPHASES;k++) {
         score[k] = (pos->stm == WHITE)?score[k]:-score[k];
     }
 
     /* Return score adjusted for game phase */
-    phase = eval_game_phase(pos);
-    tapered_score = calculate_tapered_eval(phase, score[MIDDLEGAME],
-                                           score[ENDGAME]);
+    tapered_score = calculate_tapered_eval(eval.material.phase,
+                                           score[MIDDLEGAME], score[ENDGAME]);
     return tapered_score + TEMPO_BONUS;
 }
 
-/*
- * The following combination of pieces can never lead to chekmate:
- * - King vs King
- * - King+Knight vs King
- * - King+Bishops vs King (if the bishops operate on the same color squares)
- */
-bool eval_is_material_draw(struct position *pos)
+int eval_evaluate(struct position *pos)
 {
-    int wb;
-    int wn;
-    int bb;
-    int bn;
+    int score;
 
-    if ((pos->bb_pieces[WHITE_PAWN] != 0ULL) ||
-        (pos->bb_pieces[BLACK_PAWN] != 0ULL) ||
-        (pos->bb_pieces[WHITE_ROOK] != 0ULL) ||
-        (pos->bb_pieces[BLACK_ROOK] != 0ULL) ||
-        (pos->bb_pieces[WHITE_QUEEN] != 0ULL) ||
-        (pos->bb_pieces[BLACK_QUEEN] != 0ULL)) {
-        return false;
-    }
-
-    wn = BITCOUNT(pos->bb_pieces[WHITE_KNIGHT]);
-    bn = BITCOUNT(pos->bb_pieces[BLACK_KNIGHT]);
-    wb = BITCOUNT(pos->bb_pieces[WHITE_BISHOP]);
-    bb = BITCOUNT(pos->bb_pieces[BLACK_BISHOP]);
+    assert(valid_position(pos));
 
-    /* King vs King */
-    if ((wn == 0) && (bn == 0) && (wb == 0) && (bb == 0)) {
-        return true;
-    }
-    /* Knight+King vs King */
-    if ((wn == 1) && (bn == 0) && (wb == 0) && (bb == 0)) {
-        return true;
-    }
-    /* King vs King+Knight */
-    if ((wn == 0) && (bn == 1) && (wb == 0) && (bb == 0)) {
-        return true;
-    }
-    /* King+Bishops vs King */
-    if ((wn == 0) && (bn == 0) && (wb > 0) && (bb == 0)) {
-        return !(((pos->bb_pieces[WHITE_BISHOP]&white_square_mask) != 0ULL) &&
-                    ((pos->bb_pieces[WHITE_BISHOP]&black_square_mask) != 0ULL));
+    /*
+     * The evaluation only depends on the position so the score
+     * can be taken from the evaluation cache if it is available.
+     */
+    if (pos->worker == NULL) {
+        return evaluate(pos);
     }
-    /* King vs King+Bishops */
-    if ((wn == 0) && (bn == 0) && (wb == 0) && (bb > 0)) {
-        return !(((pos->bb_pieces[BLACK_BISHOP]&white_square_mask) != 0ULL) &&
-                    ((pos->bb_pieces[BLACK_BISHOP]&black_square_mask) != 0ULL));
+    if (hash_evalcache_lookup(pos->worker, &score)) {
+        return score;
     }
+    score = evaluate(pos);
+    hash_evalcache_store(pos->worker, score);
 
-    return false;
+    return score;
+}
+
+bool eval_is_material_draw(struct position *pos)
+{
+    return is_material_draw(pos, material_draw_flags(pos->materialkey));
 }
 
 /*
@@ -1075,19 +1162,21 @@ bool eval_is_material_draw(struct position *pos)
  */
 int eval_game_phase(struct position *pos)
 {
-    int total_phase;
-    int phase;
+    uint64_t key;
+    int      total_phase;
+    int      phase;
 
+    key = pos->materialkey;
     total_phase = 24;
     phase = total_phase;
-    phase -= BITCOUNT(pos->bb_pieces[WHITE_KNIGHT]);
-    phase -= BITCOUNT(pos->bb_pieces[BLACK_KNIGHT]);
-    phase -= BITCOUNT(pos->bb_pieces[WHITE_BISHOP]);
-    phase -= BITCOUNT(pos->bb_pieces[BLACK_BISHOP]);
-    phase -= 2*BITCOUNT(pos->bb_pieces[WHITE_ROOK]);
-    phase -= 2*BITCOUNT(pos->bb_pieces[BLACK_ROOK]);
-    phase -= 4*BITCOUNT(pos->bb_pieces[WHITE_QUEEN]);
-    phase -= 4*BITCOUNT(pos->bb_pieces[BLACK_QUEEN]);
+    phase -= MATERIALKEY_COUNT(key, WHITE_KNIGHT);
+    phase -= MATERIALKEY_COUNT(key, BLACK_KNIGHT);
+    phase -= MATERIALKEY_COUNT(key, WHITE_BISHOP);
+    phase -= MATERIALKEY_COUNT(key, BLACK_BISHOP);
+    phase -= 2*MATERIALKEY_COUNT(key, WHITE_ROOK);
+    phase -= 2*MATERIALKEY_COUNT(key, BLACK_ROOK);
+    phase -= 4*MATERIALKEY_COUNT(key, WHITE_QUEEN);
+    phase -= 4*MATERIALKEY_COUNT(key, BLACK_QUEEN);
     phase = (phase*256 + (total_phase/2))/total_phase;
 
     /*
@@ -1118,6 +1207,9 @@ void eval_generate_trace(struct position *pos, struct eval_trace *trace)
         return;
     }
 
+    /* Trace material evaluation */
+    calculate_material(pos, &eval);
+
     /* Init attack table */
     init_attack_tables(pos, &eval);
 
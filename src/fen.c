@@ -27,22 +27,19 @@
 #include "board.h"
 
 /* Returns true if c is a digit between '0' and '8'. */
-#define IS_DIGIT_08(c)  ((c=='0')||(c=='1')||(c=='2')||(c=='3')|| \
-                         (c=='4')||(c=='5')||(c=='6')||(c=='7')|| \
-                         (c=='8')) \
-                        ?true:false
+#define IS_DIGIT_08(c)  (((c)=='0')||((c)=='1')||((c)=='2')||((c)=='3')|| \
+                         ((c)=='4')||((c)=='5')||((c)=='6')||((c)=='7')|| \
+                         ((c)=='8'))
 
 /* Returns true if c is a digit between '0' and '9'. */
-#define IS_DIGIT_09(c)  ((c=='0')||(c=='1')||(c=='2')||(c=='3')|| \
-                         (c=='4')||(c=='5')||(c=='6')||(c=='7')|| \
-                         (c=='8')||(c=='9')) \
-                        ?true:false
+#define IS_DIGIT_09(c)  (((c)=='0')||((c)=='1')||((c)=='2')||((c)=='3')|| \
+                         ((c)=='4')||((c)=='5')||((c)=='6')||((c)=='7')|| \
+                         ((c)=='8')||((c)=='9'))
 
 /* Returns true if c is a piece charachter. */
-#define IS_PIECE(c) ((c=='K')||(c=='Q')||(c=='R')||(c=='B')||(c=='N')||  \
-                     (c=='P')|| (c=='k')||(c=='q')||(c=='r')||(c=='b')|| \
-                     (c=='n')||(c=='p')) \
-                    ?true:false
+#define IS_PIECE(c) (((c)=='K')||((c)=='Q')||((c)=='R')||((c)=='B')|| \
+                     ((c)=='N')||((c)=='P')||((c)=='k')||((c)=='q')|| \
+                     ((c)=='r')||((c)=='b')||((c)=='n')||((c)=='p'))
 
 static int char2piece(char piece)
 {
@@ -76,6 +73,56 @@ static int char2piece(char piece)
     }
 }
 
+/*
+ * Clear castling rights for which the king or the rook is not on its
+ * home square. The move generator assumes that castling is only
+ * available when both pieces are in place.
+ */
+static void check_castling_rights(struct position *pos)
+{
+    if (pos->pieces[E1] != WHITE_KING) {
+        pos->castle &= ~(WHITE_KINGSIDE|WHITE_QUEENSIDE);
+    }
+    if (pos->pieces[H1] != WHITE_ROOK) {
+        pos->castle &= ~WHITE_KINGSIDE;
+    }
+    if (pos->pieces[A1] != WHITE_ROOK) {
+        pos->castle &= ~WHITE_QUEENSIDE;
+    }
+    if (pos->pieces[E8] != BLACK_KING) {
+        pos->castle &= ~(BLACK_KINGSIDE|BLACK_QUEENSIDE);
+    }
+    if (pos->pieces[H8] != BLACK_ROOK) {
+        pos->castle &= ~BLACK_KINGSIDE;
+    }
+    if (pos->pieces[A8] != BLACK_ROOK) {
+        pos->castle &= ~BLACK_QUEENSIDE;
+    }
+}
+
+/*
+ * Clear the en-passant target square unless it is behind
+ * a pawn that could just have been pushed two squares.
+ */
+static void check_ep_square(struct position *pos)
+{
+    int rank;
+    int delta;
+
+    if (pos->ep_sq == NO_SQUARE) {
+        return;
+    }
+
+    rank = (pos->stm == WHITE)?RANK_6:RANK_3;
+    delta = (pos->stm == WHITE)?-8:8;
+    if ((RANKNR(pos->ep_sq) != rank) ||
+        (pos->pieces[pos->ep_sq] != NO_PIECE) ||
+        (pos->pieces[pos->ep_sq-delta] != NO_PIECE) ||
+        (pos->pieces[pos->ep_sq+delta] != (PAWN+FLIP_COLOR(pos->stm)))) {
+        pos->ep_sq = NO_SQUARE;
+    }
+}
+
 bool fen_setup_board(struct position *pos, char *fenstr)
 {
     int  rank;
@@ -95,13 +142,19 @@ bool fen_setup_board(struct position *pos, char *fenstr)
             if (IS_DIGIT_08(*iter)) {
                 /* Consequtive empty squares */
                 file += *iter - '0';
+                if (file > (FILE_H+1)) {
+                    return false;
+                }
             } else if (*iter == ' ') {
                 /* End of piece placement field */
                 break;
-            } else if (IS_PIECE(*iter)) {
+            } else if ((file <= FILE_H) && IS_PIECE(*iter)) {
                 /* Piece */
                 pos->pieces[SQUARE(file, rank)] = char2piece(*iter);
                 file++;
+            } else {
+                /* Invalid character or too many pieces on the rank */
+                return false;
             }
             iter++;
         }
@@ -166,17 +219,20 @@ bool fen_setup_board(struct position *pos, char *fenstr)
         pos->ep_sq = NO_SQUARE;
         iter++;
     } else {
+        if ((*iter < 'a') || (*iter > 'h')) {
+            return false;
+        }
         file = *iter - 'a';
         rank = *(iter+1) - '1';
+        if (SQUAREOFFBOARD(file, rank)) {
+            return false;
+        }
         pos->ep_sq = SQUARE(file, rank);
         iter += 2;
     }
     if ((*iter != ' ') && (*iter != '\0')) {
         return false;
     }
-    if ((pos->castle < A1) || (pos->ep_sq > NO_SQUARE)) {
-        return false;
-    }
 
     /*
      * Allow the 'halfmove' and 'full move' fields to be
@@ -224,9 +280,30 @@ bool fen_setup_board(struct position *pos, char *fenstr)
         }
     }
 
+    /* Pawns can never be on the first or last rank */
+    if (((pos->bb_pieces[WHITE_PAWN]|pos->bb_pieces[BLACK_PAWN])&
+         (rank_mask[RANK_1]|rank_mask[RANK_8])) != 0ULL) {
+        return false;
+    }
+
+    /* Remove castling rights and en-passant squares that are not possible */
+    check_castling_rights(pos);
+    check_ep_square(pos);
+
+    /*
+     * The material signature can only hold up to
+     * 15 pieces of each kind (see key.h).
+     */
+    for (k=0;k<NPIECES;k++) {
+        if (BITCOUNT(pos->bb_pieces[k]) > 15) {
+            return false;
+        }
+    }
+
     /* Generate a key for the position */
     pos->key = key_generate(pos);
     pos->pawnkey = key_generate_pawnkey(pos);
+    pos->materialkey = key_generate_materialkey(pos);
 
     return true;
 }
@@ -29,19 +29,101 @@
 #include "utils.h"
 #include "smp.h"
 #include "config.h"
+#include "numa.h"
+#include "cluster.h"
+
+/* Macros for packing and unpacking the data stored in struct tt_entry */
+#define TT_DATA(m, s, e, d, t, g) \
+                                (((uint64_t)(m))| \
+                                 (((uint64_t)(uint16_t)(s))<<16)| \
+                                 (((uint64_t)(uint16_t)(e))<<32)| \
+                                 (((uint64_t)(d)&0xFF)<<48)| \
+                                 (((uint64_t)((t)+1)&0x3)<<56)| \
+                                 (((uint64_t)(g)&0x3F)<<58))
+#define TT_MOVE(d)              ((uint16_t)((d)&0xFFFF))
+#define TT_SCORE(d)             ((int16_t)(((d)>>16)&0xFFFF))
+#define TT_EVAL(d)              ((int16_t)(((d)>>32)&0xFFFF))
+#define TT_DEPTH(d)             ((uint8_t)(((d)>>48)&0xFF))
+#define TT_TYPE(d)              ((uint8_t)((((d)>>56)&0x3)-1))
+#define TT_GENERATION(d)        ((uint8_t)(((d)>>58)&0x3F))
+#define TT_IS_USED(d)           ((((d)>>56)&0x3) != 0)
+
+/* The number of different generations that can be stored in an entry */
+#define TT_NGENERATIONS 64
+
+/* The generation of the current search */
+#define TT_CURRENT_GENERATION (tt_date%TT_NGENERATIONS)
+
+/* Macros for the key word stored in struct tt_entry */
+#define TT_ENTRY_KEY(k, e)  (((uint32_t)(k)&0x00FFFFFF)|(((uint32_t)(e))<<24))
+#define TT_ENTRY_EPOCH(w)   ((uint8_t)((w)>>24))
+
+/* Check if an entry is used and belongs to the current epoch */
+#define TT_IS_VALID(w, d)   (TT_IS_USED(d) && (TT_ENTRY_EPOCH(w) == tt_epoch))
+
+/* Macros for the 16-bit move encoding used in struct tt_entry */
+#define TT_MOVE_PROMOTION  1
+#define TT_MOVE_EN_PASSANT 2
+#define TT_MOVE_CASTLE     3
+
+/* Identification of transposition table files */
+#define TT_FILE_MAGIC "MARVINTT"
+#define TT_FILE_BYTE_ORDER 0x01020304
 
-/* Macros for managing the hash key stored in struct tt_item */
-#define KEY_LOW(k)  ((uint32_t)((k)&0x00000000FFFFFFFF))
-#define KEY_HIGH(k) ((uint32_t)(((k)>>32)&0x00000000FFFFFFFF))
-#define KEY_EQUALS(k, i) \
-                (k) == ((((uint64_t)(i)->key_high)<<32)|(uint64_t)(i)->key_low)
-#define KEY_IS_ZERO(i) ((i)->key_low == 0ULL) && ((i)->key_high == 0ULL)
+/*
+ * The version of the entry format. Should be increased every time
+ * struct tt_entry or the way data is packed in it is changed.
+ */
+#define TT_FILE_FORMAT 2
+
+/* The amount of data to read or write at a time for table files */
+#define TT_FILE_CHUNK_SIZE (64*1024*1024)
+
+/*
+ * Header of a transposition table file. The header is followed by
+ * the buckets of the table exactly as they are stored in memory.
+ */
+struct tt_file_header {
+    char     magic[8];
+    uint32_t byte_order;
+    uint32_t format;
+    uint32_t bucket_size;
+    uint32_t entries_per_bucket;
+    uint64_t nbuckets;
+    uint32_t size_mb;
+    uint32_t date;
+    uint32_t epoch;
+    uint32_t reserved;
+};
 
 /* Main transposition table */
 static struct tt_bucket *transposition_table = NULL;
 static uint64_t tt_size = 0ULL;
 static uint8_t tt_date = 0;
 
+/*
+ * The epoch of the main transposition table. Increasing the epoch
+ * invalidates all entries stored in the table.
+ */
+static uint8_t tt_epoch = 0;
+
+/* The number of items in each pawn transposition table bucket */
+#define PAWNTT_BUCKET_SIZE 2
+
+/* Mask for the part of the key that is stored in evaluation cache entries */
+#define EVALCACHE_KEY_MASK 0xFFFFFFFFFFFF0000ULL
+
+/* Pawn transposition table shared by all workers */
+static bool pawntt_shared = false;
+static struct pawntt_item *shared_pawntt = NULL;
+static int shared_pawntt_size = 0;
+static int shared_pawntt_users = 0;
+
+/* Memory backing of the main transposition table */
+static bool tt_large_pages = true;
+static int tt_backing = MEMORY_NORMAL_PAGES;
+static int tt_size_mb = 0;
+
 static int largest_power_of_2(uint64_t size, int item_size)
 {
     uint64_t largest;
@@ -57,26 +139,210 @@ static int largest_power_of_2(uint64_t size, int item_size)
     return largest;
 }
 
+/*
+ * Encode a move using 16 bits. The move type flags are not stored since
+ * they can be recovered from the position except for the special moves
+ * which are flagged explicitly.
+ */
+static uint16_t encode_move(uint32_t move)
+{
+    uint16_t special;
+    uint16_t promotion;
+
+    if (move == NOMOVE) {
+        return 0;
+    }
+
+    special = 0;
+    promotion = 0;
+    if (ISPROMOTION(move)) {
+        special = TT_MOVE_PROMOTION;
+        promotion = (VALUE(PROMOTION(move)) - KNIGHT)/2;
+    } else if (ISENPASSANT(move)) {
+        special = TT_MOVE_EN_PASSANT;
+    } else if (ISKINGSIDECASTLE(move) || ISQUEENSIDECASTLE(move)) {
+        special = TT_MOVE_CASTLE;
+    }
+
+    return (uint16_t)(FROM(move)|(TO(move)<<6)|(special<<12)|(promotion<<14));
+}
+
+/*
+ * Decode a move encoded by encode_move. The position must be the
+ * position that the move was stored for.
+ */
+static uint32_t decode_move(struct position *pos, uint16_t encoded)
+{
+    int from;
+    int to;
+    int promotion;
+    int flags;
+
+    if (encoded == 0) {
+        return NOMOVE;
+    }
+
+    from = encoded&0x3F;
+    to = (encoded>>6)&0x3F;
+    promotion = NO_PIECE;
+    flags = (pos->pieces[to] != NO_PIECE)?CAPTURE:NORMAL;
+    switch ((encoded>>12)&0x3) {
+    case TT_MOVE_PROMOTION:
+        flags |= PROMOTION;
+        promotion = KNIGHT + 2*((encoded>>14)&0x3) + pos->stm;
+        break;
+    case TT_MOVE_EN_PASSANT:
+        flags = EN_PASSANT;
+        break;
+    case TT_MOVE_CASTLE:
+        flags = (to > from)?KINGSIDE_CASTLE:QUEENSIDE_CASTLE;
+        break;
+    default:
+        break;
+    }
+
+    return MOVE(from, to, promotion, flags);
+}
+
+/*
+ * The table is shared between all workers without any locking so an
+ * entry is read once and the key is recovered from the data. If the
+ * entry is being written by another worker at the same time then the
+ * recovered key will not match.
+ */
+static uint64_t read_entry(struct tt_entry *entry, uint32_t *key)
+{
+    uint32_t data_low;
+    uint32_t data_high;
+
+    *key = entry->key;
+    data_low = entry->data_low;
+    data_high = entry->data_high;
+    *key ^= data_low^data_high;
+
+    return (((uint64_t)data_high)<<32)|data_low;
+}
+
+static void write_entry(struct tt_entry *entry, uint32_t key, uint64_t data)
+{
+    entry->key = key^(uint32_t)data^(uint32_t)(data>>32);
+    entry->data_low = (uint32_t)data;
+    entry->data_high = (uint32_t)(data>>32);
+}
+
+/*
+ * Map a key to a bucket in the main transposition table. The high
+ * part of the 128-bit product of the key and the number of buckets
+ * is evenly distributed over 0..tt_size-1 so the number of buckets
+ * does not have to be a power of 2.
+ */
+static inline uint64_t bucket_index(uint64_t key)
+{
+#ifdef __SIZEOF_INT128__
+    return (uint64_t)(((unsigned __int128)key*tt_size) >> 64);
+#else
+    uint64_t key_low = key&0xFFFFFFFFULL;
+    uint64_t key_high = key >> 32;
+    uint64_t size_low = tt_size&0xFFFFFFFFULL;
+    uint64_t size_high = tt_size >> 32;
+    uint64_t mid;
+
+    mid = key_high*size_low + ((key_low*size_low) >> 32);
+    return key_high*size_high + (mid >> 32) +
+                        (((mid&0xFFFFFFFFULL) + key_low*size_high) >> 32);
+#endif
+}
+
 static void allocate_tt(int size)
 {
-    tt_size = largest_power_of_2(size, sizeof(struct tt_bucket));
-    transposition_table = aligned_malloc(CACHE_LINE_SIZE,
-                                         tt_size*sizeof(struct tt_bucket));
+    tt_size = (size*1024ULL*1024ULL)/sizeof(struct tt_bucket);
+    if (tt_large_pages) {
+        transposition_table = large_pages_malloc(
+                                            tt_size*sizeof(struct tt_bucket),
+                                            &tt_backing);
+    } else {
+        tt_backing = MEMORY_NORMAL_PAGES;
+        transposition_table = aligned_malloc(CACHE_LINE_SIZE,
+                                             tt_size*sizeof(struct tt_bucket));
+    }
     if (transposition_table == NULL) {
-        tt_size = largest_power_of_2(MIN_MAIN_HASH_SIZE,
-                                     sizeof(struct tt_bucket));
+        tt_backing = MEMORY_NORMAL_PAGES;
+        tt_size = (MIN_MAIN_HASH_SIZE*1024ULL*1024ULL)/
+                                                    sizeof(struct tt_bucket);
         transposition_table = aligned_malloc(CACHE_LINE_SIZE,
                                              tt_size*sizeof(struct tt_bucket));
     }
     assert(transposition_table != NULL);
+
+    /*
+     * The table is accessed by all workers so spread it
+     * evenly over all NUMA nodes.
+     */
+    numa_interleave_memory(transposition_table,
+                           tt_size*sizeof(struct tt_bucket));
 }
 
-static void allocate_pawntt(struct search_worker *worker, int size)
+static struct pawntt_item* allocate_pawntt(int size, int *nitems)
 {
-    worker->pawntt_size = largest_power_of_2(size, sizeof(struct pawntt_item));
-    worker->pawntt = aligned_malloc(CACHE_LINE_SIZE,
-                                worker->pawntt_size*sizeof(struct pawntt_item));
-    assert(worker->pawntt != NULL);
+    struct pawntt_item *table;
+
+    *nitems = largest_power_of_2(size, sizeof(struct pawntt_item));
+    table = aligned_malloc(CACHE_LINE_SIZE,
+                           (*nitems)*sizeof(struct pawntt_item));
+    assert(table != NULL);
+
+    return table;
+}
+
+/* Get the pawn transposition table bucket for the current position */
+static inline struct pawntt_item* pawntt_bucket(struct search_worker *worker)
+{
+    uint64_t nbuckets = worker->pawntt_size/PAWNTT_BUCKET_SIZE;
+
+    return &worker->pawntt[(worker->pos.pawnkey&(nbuckets-1))*
+                                                        PAWNTT_BUCKET_SIZE];
+}
+
+/* Get the material transposition table item for the current position */
+static inline struct materialtt_item*
+materialtt_item(struct search_worker *worker)
+{
+    uint64_t key = worker->pos.materialkey;
+
+    /*
+     * The signature consists of small piece counts so it is
+     * mixed before it is used to select an item.
+     */
+    return &worker->materialtt[((key*0x9E3779B97F4A7C15ULL)>>32)&
+                                                        (MATERIALTT_SIZE-1)];
+}
+
+/*
+ * The pawn transposition table can be shared between workers without
+ * any locking so an item can end up with parts from two different
+ * writes. To detect this the pawn key of a stored item is xor:ed with
+ * a checksum of the rest of the item.
+ */
+static uint64_t pawntt_checksum(struct pawntt_item *item)
+{
+    uint64_t words[sizeof(struct pawntt_item)/sizeof(uint64_t)];
+    uint64_t checksum;
+    int      k;
+
+    memcpy(words, item, sizeof(struct pawntt_item));
+    checksum = 0ULL;
+    for (k=1;k<(int)(sizeof(words)/sizeof(uint64_t));k++) {
+        checksum ^= words[k];
+    }
+    return checksum;
+}
+
+/* Physically clear the main transposition table */
+static void clear_tt(void)
+{
+    parallel_memset(transposition_table, 0, tt_size*sizeof(struct tt_bucket),
+                    smp_number_of_workers());
+    tt_epoch = 0;
 }
 
 int hash_tt_max_size(void)
@@ -84,6 +350,11 @@ int hash_tt_max_size(void)
 	return is64bit()?MAX_MAIN_HASH_SIZE_64BIT:MAX_MAIN_HASH_SIZE_32BIT;
 }
 
+int hash_tt_size(void)
+{
+    return tt_size_mb;
+}
+
 void hash_tt_create_table(int size)
 {
 	assert((size >= MIN_MAIN_HASH_SIZE) && (size <= hash_tt_max_size()));
@@ -91,23 +362,175 @@ void hash_tt_create_table(int size)
     hash_tt_destroy_table();
 
     allocate_tt(size);
-    hash_tt_clear_table();
+    tt_size_mb = size;
+    clear_tt();
 }
 
 void hash_tt_destroy_table(void)
 {
-    aligned_free(transposition_table);
+    large_pages_free(transposition_table, tt_size*sizeof(struct tt_bucket),
+                     tt_backing);
     transposition_table = NULL;
     tt_size = 0ULL;
     tt_date = 0;
+    tt_epoch = 0;
+    tt_backing = MEMORY_NORMAL_PAGES;
+    tt_size_mb = 0;
+}
+
+void hash_tt_set_large_pages(bool enable)
+{
+    if (enable == tt_large_pages) {
+        return;
+    }
+
+    tt_large_pages = enable;
+    if (transposition_table != NULL) {
+        hash_tt_create_table(tt_size_mb);
+    }
+}
+
+int hash_tt_memory_backing(void)
+{
+    return tt_backing;
 }
 
 void hash_tt_clear_table(void)
 {
     assert(transposition_table != NULL);
 
-    parallel_memset(transposition_table, 0, tt_size*sizeof(struct tt_bucket),
-                    smp_number_of_workers());
+    /*
+     * Start a new epoch to invalidate all entries. The table only
+     * has to be cleared for real when the epoch counter wraps since
+     * entries from the new epoch could exist in the table.
+     */
+    tt_epoch++;
+    if (tt_epoch == 0) {
+        clear_tt();
+    }
+}
+
+bool hash_tt_save(char *path)
+{
+    FILE                  *fp;
+    struct tt_file_header header;
+    uint8_t               *iter;
+    uint64_t              left;
+    size_t                chunk;
+    bool                  ok;
+
+    assert(path != NULL);
+
+    if (transposition_table == NULL) {
+        return false;
+    }
+    fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    memset(&header, 0, sizeof(struct tt_file_header));
+    memcpy(header.magic, TT_FILE_MAGIC, sizeof(header.magic));
+    header.byte_order = TT_FILE_BYTE_ORDER;
+    header.format = TT_FILE_FORMAT;
+    header.bucket_size = sizeof(struct tt_bucket);
+    header.entries_per_bucket = TT_BUCKET_SIZE;
+    header.nbuckets = tt_size;
+    header.size_mb = tt_size_mb;
+    header.date = tt_date;
+    header.epoch = tt_epoch;
+    ok = fwrite(&header, sizeof(struct tt_file_header), 1, fp) == 1;
+
+    /* Write the table as it is stored in memory */
+    iter = (uint8_t*)transposition_table;
+    left = tt_size*sizeof(struct tt_bucket);
+    while (ok && (left > 0)) {
+        chunk = (size_t)MIN(left, (uint64_t)TT_FILE_CHUNK_SIZE);
+        ok = fwrite(iter, 1, chunk, fp) == chunk;
+        iter += chunk;
+        left -= chunk;
+    }
+
+    if (fclose(fp) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        remove(path);
+    }
+
+    return ok;
+}
+
+bool hash_tt_load(char *path)
+{
+    FILE                  *fp;
+    struct tt_file_header header;
+    uint8_t               *iter;
+    uint64_t              left;
+    size_t                chunk;
+    bool                  ok;
+
+    assert(path != NULL);
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    /*
+     * Make sure that the file was written using the same
+     * entry format and that it fits in the allowed memory.
+     */
+    if ((fread(&header, sizeof(struct tt_file_header), 1, fp) != 1) ||
+        (memcmp(header.magic, TT_FILE_MAGIC, sizeof(header.magic)) != 0) ||
+        (header.byte_order != TT_FILE_BYTE_ORDER) ||
+        (header.format != TT_FILE_FORMAT) ||
+        (header.bucket_size != sizeof(struct tt_bucket)) ||
+        (header.entries_per_bucket != TT_BUCKET_SIZE) ||
+        (header.size_mb < MIN_MAIN_HASH_SIZE) ||
+        (header.size_mb > (uint32_t)hash_tt_max_size()) ||
+        (header.nbuckets != (header.size_mb*1024ULL*1024ULL)/
+                                                sizeof(struct tt_bucket))) {
+        fclose(fp);
+        return false;
+    }
+
+    /*
+     * Re-create the table with the same size as the saved table. The
+     * table is not cleared since it is overwritten by the file data.
+     */
+    if ((transposition_table == NULL) || (tt_size != header.nbuckets)) {
+        hash_tt_destroy_table();
+        allocate_tt(header.size_mb);
+        tt_size_mb = header.size_mb;
+        if (tt_size != header.nbuckets) {
+            clear_tt();
+            fclose(fp);
+            return false;
+        }
+    }
+
+    /* Stream the table directly in to memory */
+    iter = (uint8_t*)transposition_table;
+    left = tt_size*sizeof(struct tt_bucket);
+    ok = true;
+    while (ok && (left > 0)) {
+        chunk = (size_t)MIN(left, (uint64_t)TT_FILE_CHUNK_SIZE);
+        ok = fread(iter, 1, chunk, fp) == chunk;
+        iter += chunk;
+        left -= chunk;
+    }
+    fclose(fp);
+
+    /* Never leave a partially loaded table behind */
+    if (!ok) {
+        clear_tt();
+        return false;
+    }
+    tt_date = (uint8_t)header.date;
+    tt_epoch = (uint8_t)header.epoch;
+
+    return true;
 }
 
 void hash_tt_age_table(void)
@@ -115,75 +538,50 @@ void hash_tt_age_table(void)
     tt_date++;
 }
 
-void hash_tt_store(struct position *pos, uint32_t move, int depth, int score,
-                   int type, int eval_score)
+static void store_entry(uint64_t poskey, uint32_t move, int depth, int score,
+                        int type, int eval_score)
 {
     uint64_t         idx;
     struct tt_bucket *bucket;
-    struct tt_item   *item;
-    struct tt_item   *worst_item;
-    int              item_score;
+    struct tt_entry  *entry;
+    uint32_t         key;
+    uint64_t         data;
+    int              worst_idx;
+    uint64_t         worst_data;
+    int              entry_score;
     int              worst_score;
     int              k;
     uint8_t          age;
 
-    assert(valid_position(pos));
-    assert(valid_move(move));
-    assert((score > -INFINITE_SCORE) && (score < INFINITE_SCORE));
-
     if (transposition_table == NULL) {
         return;
     }
 
-    /*
-     * Mate scores are dependent on search depth so if nothing is done
-     * they will be incorrect if the position is found at a different
-     * depth. Therefore the scores are adjusted so that they are stored
-     * as mate-in-n from the _current_ position instead of from the root
-     * of the search tree. Based on this a correct mate score can be
-     * calculated when retrieving the entry.
-     *
-     * Additionally only store mate scores as TT_EXACT entries, not
-     * as boundaries. The reason is that the score have taken on a
-     * different meaning in these cases since the mate was actually
-     * found in a different part of the tree.
-     *
-     * The same reasoning also applies to tablebase wins/losses so
-     * they are treated the same way.
-     */
-    if (score > KNOWN_WIN) {
-        if (type != TT_EXACT) {
-            return;
-        }
-        score += pos->sply;
-    } else if (score < -KNOWN_WIN) {
-        if (type != TT_EXACT) {
-            return;
-        }
-        score -= pos->sply;
-    }
-
     /* Find the correct bucket */
-    idx = (uint64_t)(pos->key&(tt_size-1));
+    idx = bucket_index(poskey);
     bucket = &transposition_table[idx];
 
     /*
-     * Iterate over all items and find the best
+     * Iterate over all entries and find the best
      * location to store this position at.
      */
-    worst_item = NULL;
+    worst_idx = -1;
+    worst_data = 0ULL;
     worst_score = INT_MAX;
     for (k=0;k<TT_BUCKET_SIZE;k++) {
-        item = &bucket->items[k];
+        entry = &bucket->entries[k];
+        data = read_entry(entry, &key);
 
         /*
          * If the same position is already stored then
          * replace it if the new search is to a greater
-         * depth or if the item have an older date.
+         * depth or if the entry is from an older search.
          */
-        if (KEY_EQUALS(pos->key, item)) {
-            if ((depth >= item->depth) || (tt_date != item->date)) {
-                worst_item = item;
+        if (TT_IS_VALID(key, data) &&
+            (key == TT_ENTRY_KEY(poskey, tt_epoch))) {
+            if ((depth >= TT_DEPTH(data)) ||
+                (TT_GENERATION(data) != TT_CURRENT_GENERATION)) {
+                worst_idx = k;
                 break;
             }
 
@@ -192,43 +590,101 @@ void hash_tt_store(struct position *pos, uint32_t move, int depth, int score,
              * the current position.
              */
             return;
-        } else if (KEY_IS_ZERO(item)) {
-            worst_item = item;
+        } else if (!TT_IS_VALID(key, data)) {
+            worst_idx = k;
+            worst_data = 0ULL;
             break;
         }
 
         /*
-         * Calculate a score for the item. The main idea is to
+         * Calculate a score for the entry. The main idea is to
          * prefer searches to a higher depth and to prefer
          * newer searches before older ones.
          */
-        age = tt_date - item->date;
-        item_score = (256 - age - 1) + item->depth*256;
+        age = (TT_CURRENT_GENERATION - TT_GENERATION(data))&
+                                                        (TT_NGENERATIONS-1);
+        entry_score = (TT_NGENERATIONS - age - 1) +
+                                            TT_DEPTH(data)*TT_NGENERATIONS;
+
+        /* Remeber the entry with the worst score */
+        if (entry_score < worst_score) {
+            worst_score = entry_score;
+            worst_idx = k;
+            worst_data = data;
+        }
+    }
+    assert(worst_idx >= 0);
 
-        /* Remeber the item with the worst score */
-        if (item_score < worst_score) {
-            worst_score = item_score;
-            worst_item = item;
+    /*
+     * Quiescence entries are cheap to recreate and very numerous so
+     * they are not allowed to push out entries from the main search
+     * of the current generation.
+     */
+    if ((depth == TT_QUIESCENCE_DEPTH) && (worst_data != 0ULL) &&
+        (TT_DEPTH(worst_data) > TT_QUIESCENCE_DEPTH) &&
+        (TT_GENERATION(worst_data) == TT_CURRENT_GENERATION)) {
+        return;
+    }
+
+    /* Replace the worst entry */
+    data = TT_DATA(encode_move(move), score, eval_score, depth, type,
+                   TT_CURRENT_GENERATION);
+    write_entry(&bucket->entries[worst_idx], TT_ENTRY_KEY(poskey, tt_epoch),
+                data);
+}
+
+void hash_tt_store(struct position *pos, uint32_t move, int depth, int score,
+                   int type, int eval_score)
+{
+    assert(valid_position(pos));
+    assert(valid_move(move));
+    assert(decode_move(pos, encode_move(move)) == move);
+    assert((score > -INFINITE_SCORE) && (score < INFINITE_SCORE));
+
+    /*
+     * Mate scores are dependent on search depth so if nothing is done
+     * they will be incorrect if the position is found at a different
+     * depth. Therefore the scores are adjusted so that they are stored
+     * as mate-in-n from the _current_ position instead of from the root
+     * of the search tree. Based on this a correct mate score can be
+     * calculated when retrieving the entry.
+     *
+     * Additionally only store mate scores as TT_EXACT entries, not
+     * as boundaries. The reason is that the score have taken on a
+     * different meaning in these cases since the mate was actually
+     * found in a different part of the tree.
+     *
+     * The same reasoning also applies to tablebase wins/losses so
+     * they are treated the same way.
+     */
+    if (score > KNOWN_WIN) {
+        if (type != TT_EXACT) {
+            return;
         }
+        score += pos->sply;
+    } else if (score < -KNOWN_WIN) {
+        if (type != TT_EXACT) {
+            return;
+        }
+        score -= pos->sply;
     }
-    assert(worst_item != NULL);
 
-    /* Replace the worst item */
-    worst_item->key_high = KEY_HIGH(pos->key);
-    worst_item->key_low = KEY_LOW(pos->key);
-    worst_item->move = move;
-    worst_item->score = (int16_t)score;
-    worst_item->eval_score = (int16_t)eval_score;
-    worst_item->depth = depth;
-    worst_item->type = type;
-    worst_item->date = tt_date;
+    store_entry(pos->key, move, depth, score, type, eval_score);
+    cluster_share_tt_entry(pos->key, move, depth, score, type, eval_score);
+}
+
+void hash_tt_store_shared(uint64_t key, uint32_t move, int depth, int score,
+                          int type, int eval_score)
+{
+    store_entry(key, move, depth, score, type, eval_score);
 }
 
 bool hash_tt_lookup(struct position *pos, struct tt_item *item)
 {
     uint64_t         idx;
     struct tt_bucket *bucket;
-    struct tt_item   *tmp;
+    uint32_t         key;
+    uint64_t         data;
     int              k;
 
     assert(valid_position(pos));
@@ -239,17 +695,23 @@ bool hash_tt_lookup(struct position *pos, struct tt_item *item)
     }
 
     /* Find the correct bucket */
-    idx = (uint64_t)(pos->key&(tt_size-1));
+    idx = bucket_index(pos->key);
     bucket = &transposition_table[idx];
 
     /*
-     * Find the first item, if any, that have
-     * the same key as the current position.
+     * Find the first entry, if any, that have the
+     * same key as the current position.
      */
     for (k=0;k<TT_BUCKET_SIZE;k++) {
-        tmp = &bucket->items[k];
-        if (KEY_EQUALS(pos->key, tmp)) {
-            memcpy(item, tmp, sizeof(struct tt_item));
+        data = read_entry(&bucket->entries[k], &key);
+        if (TT_IS_VALID(key, data) &&
+            (key == TT_ENTRY_KEY(pos->key, tt_epoch))) {
+            item->move = decode_move(pos, TT_MOVE(data));
+            item->score = TT_SCORE(data);
+            item->eval_score = TT_EVAL(data);
+            item->depth = TT_DEPTH(data);
+            item->type = TT_TYPE(data);
+            item->date = TT_GENERATION(data);
             return true;
         }
     }
@@ -261,15 +723,18 @@ bool hash_tt_lookup(struct position *pos, struct tt_item *item)
 int hash_tt_usage(void)
 {
     struct tt_bucket *bucket;
-    int k;
-    int idx;
-    int nused;
+    uint32_t         key;
+    uint64_t         data;
+    int              k;
+    int              idx;
+    int              nused;
 
     nused = 0;
     for (k=0;k<=1000;k++) {
         bucket = &transposition_table[k];
         for (idx=0;idx<TT_BUCKET_SIZE;idx++) {
-            if (bucket->items[idx].date > 0) {
+            data = read_entry(&bucket->entries[idx], &key);
+            if (TT_IS_VALID(key, data)) {
                 nused++;
             }
         }
@@ -278,19 +743,58 @@ int hash_tt_usage(void)
     return nused/TT_BUCKET_SIZE;
 }
 
+void hash_pawntt_set_shared(bool shared)
+{
+    pawntt_shared = shared;
+}
+
 void hash_pawntt_create_table(struct search_worker *worker, int size)
 {
     assert(size >= 0);
 
     hash_pawntt_destroy_table(worker);
 
-    allocate_pawntt(worker, size);
+    /*
+     * When a shared table is used all workers are attached to the
+     * same table which is created by the first worker.
+     */
+    if (pawntt_shared) {
+        if (shared_pawntt == NULL) {
+            shared_pawntt = allocate_pawntt(size, &shared_pawntt_size);
+            numa_interleave_memory(shared_pawntt,
+                               shared_pawntt_size*sizeof(struct pawntt_item));
+            memset(shared_pawntt, 0,
+                   shared_pawntt_size*sizeof(struct pawntt_item));
+        }
+        worker->pawntt = shared_pawntt;
+        worker->pawntt_size = shared_pawntt_size;
+        shared_pawntt_users++;
+        return;
+    }
+
+    worker->pawntt = allocate_pawntt(size, &worker->pawntt_size);
+    numa_place_memory(worker->pawntt,
+                      worker->pawntt_size*sizeof(struct pawntt_item),
+                      numa_node_for_worker(worker->id));
     hash_pawntt_clear_table(worker);
 }
 
 void hash_pawntt_destroy_table(struct search_worker *worker)
 {
-    aligned_free(worker->pawntt);
+    if (worker->pawntt == NULL) {
+        return;
+    }
+
+    if (worker->pawntt == shared_pawntt) {
+        shared_pawntt_users--;
+        if (shared_pawntt_users == 0) {
+            aligned_free(shared_pawntt);
+            shared_pawntt = NULL;
+            shared_pawntt_size = 0;
+        }
+    } else {
+        aligned_free(worker->pawntt);
+    }
     worker->pawntt = NULL;
     worker->pawntt_size = 0;
 }
@@ -313,8 +817,10 @@ void hash_pawntt_init_item(struct pawntt_item *item)
 
 void hash_pawntt_store(struct search_worker *worker, struct pawntt_item *item)
 {
-    struct position *pos;
-    uint32_t        idx;
+    struct position    *pos;
+    struct pawntt_item *bucket;
+    struct pawntt_item entry;
+    int                k;
 
     assert(valid_position(&worker->pos));
     assert(item != NULL);
@@ -325,22 +831,34 @@ void hash_pawntt_store(struct search_worker *worker, struct pawntt_item *item)
         return;
     }
 
-    /* Find the correct position in the table */
-    idx = (uint32_t)(pos->pawnkey&(worker->pawntt_size-1));
+    /* Find the correct bucket in the table */
+    bucket = pawntt_bucket(worker);
+
+    /* Prepare the item to store */
+    entry = *item;
+    entry.pawnkey = pos->pawnkey^pawntt_checksum(&entry);
 
     /*
-     * Insert the item in the table. An always-replace strategy
-     * is used in case the position is already taken.
+     * If the position is already stored then it is replaced. Otherwise
+     * the most recently stored items are kept at the front of the bucket
+     * and the oldest item is replaced.
      */
-    worker->pawntt[idx] = *item;
-    worker->pawntt[idx].pawnkey = pos->pawnkey;
+    for (k=0;k<PAWNTT_BUCKET_SIZE-1;k++) {
+        if ((bucket[k].pawnkey^pawntt_checksum(&bucket[k])) == pos->pawnkey) {
+            break;
+        }
+    }
+    for (;k>0;k--) {
+        bucket[k] = bucket[k-1];
+    }
+    bucket[0] = entry;
 }
 
 bool hash_pawntt_lookup(struct search_worker *worker, struct pawntt_item *item)
 {
-    struct position *pos;
-    uint32_t        idx;
-    bool            found;
+    struct position    *pos;
+    struct pawntt_item *bucket;
+    int                k;
 
     assert(valid_position(&worker->pos));
     assert(item != NULL);
@@ -352,21 +870,93 @@ bool hash_pawntt_lookup(struct search_worker *worker, struct pawntt_item *item)
     }
 
     /*
-     * Find the correct position in the table and check
-     * if it contains an item for this position.
+     * Find the correct bucket in the table and check if
+     * it contains an item for this position. Each item is
+     * copied before it is checked since other workers can
+     * write to the table at the same time.
      */
-    found = false;
-    idx = (uint32_t)(pos->pawnkey&(worker->pawntt_size-1));
-    if (worker->pawntt[idx].pawnkey == pos->pawnkey) {
-        found = true;
-        *item = worker->pawntt[idx];
+    worker->pawntt_probes++;
+    bucket = pawntt_bucket(worker);
+    for (k=0;k<PAWNTT_BUCKET_SIZE;k++) {
+        *item = bucket[k];
+        if (item->used &&
+            ((item->pawnkey^pawntt_checksum(item)) == pos->pawnkey)) {
+            item->pawnkey = pos->pawnkey;
+            worker->pawntt_hits++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void hash_materialtt_store(struct search_worker *worker,
+                           struct materialtt_item *item)
+{
+    struct materialtt_item *entry;
+
+    assert(valid_position(&worker->pos));
+    assert(item != NULL);
+
+    entry = materialtt_item(worker);
+    *entry = *item;
+    entry->materialkey = worker->pos.materialkey;
+}
+
+bool hash_materialtt_lookup(struct search_worker *worker,
+                            struct materialtt_item *item)
+{
+    struct materialtt_item *entry;
+
+    assert(valid_position(&worker->pos));
+    assert(item != NULL);
+
+    /*
+     * The table is private to the worker and the signature is
+     * unique for each material distribution so no verification
+     * is needed other than comparing the signature.
+     */
+    entry = materialtt_item(worker);
+    if (entry->materialkey != worker->pos.materialkey) {
+        return false;
+    }
+    *item = *entry;
+
+    return true;
+}
+
+void hash_evalcache_store(struct search_worker *worker, int score)
+{
+    uint64_t key = worker->pos.key;
+
+    assert(valid_position(&worker->pos));
+    assert((score >= INT16_MIN) && (score <= INT16_MAX));
+
+    worker->evalcache[key&(EVALCACHE_SIZE-1)] =
+                            (key&EVALCACHE_KEY_MASK)|(uint16_t)(int16_t)score;
+}
+
+bool hash_evalcache_lookup(struct search_worker *worker, int *score)
+{
+    uint64_t key = worker->pos.key;
+    uint64_t entry;
+
+    assert(valid_position(&worker->pos));
+    assert(score != NULL);
+
+    entry = worker->evalcache[key&(EVALCACHE_SIZE-1)];
+    if ((entry&EVALCACHE_KEY_MASK) != (key&EVALCACHE_KEY_MASK)) {
+        return false;
     }
+    *score = (int16_t)(entry&~EVALCACHE_KEY_MASK);
 
-    return found && item->used;
+    return true;
 }
 
 void hash_prefetch(struct search_worker *worker)
 {
-    PREFETCH_ADDRESS(&transposition_table[worker->pos.key&(tt_size-1)]);
-    PREFETCH_ADDRESS(&worker->pawntt[worker->pos.pawnkey&(worker->pawntt_size-1)]);
+    PREFETCH_ADDRESS(&transposition_table[bucket_index(worker->pos.key)]);
+    PREFETCH_ADDRESS(pawntt_bucket(worker));
+    PREFETCH_ADDRESS(materialtt_item(worker));
+    PREFETCH_ADDRESS(&worker->evalcache[worker->pos.key&(EVALCACHE_SIZE-1)]);
 }
@@ -29,6 +29,12 @@ enum {
     TT_ALPHA
 };
 
+/*
+ * The depth used for entries stored by the quiescence search. The main
+ * search always stores entries with a depth of at least one.
+ */
+#define TT_QUIESCENCE_DEPTH 0
+
 /*
  * Get the maximum transposition table size.
  *
@@ -36,6 +42,13 @@ enum {
  */
 int hash_tt_max_size(void);
 
+/*
+ * Get the current size of the main transposition table.
+ *
+ * @return Returns the size (in MB).
+ */
+int hash_tt_size(void);
+
 /*
  * Create the main transposition table.
  *
@@ -49,10 +62,47 @@ void hash_tt_create_table(int size);
 void hash_tt_destroy_table(void);
 
 /*
- * Clear the main transposition table.
+ * Enable or disable the use of huge pages for the main transposition
+ * table. If the table already exists then it is re-created.
+ *
+ * @param enable Flag indicating if huge pages should be used.
+ */
+void hash_tt_set_large_pages(bool enable);
+
+/*
+ * Get the kind of memory backing used for the main transposition table.
+ *
+ * @return Returns one of the MEMORY_* constants defined in utils.h.
+ */
+int hash_tt_memory_backing(void);
+
+/*
+ * Clear the main transposition table. The entries are invalidated
+ * logically so the time needed does not depend on the size of the table.
  */
 void hash_tt_clear_table(void);
 
+/*
+ * Save the main transposition table to a file.
+ *
+ * @param path The file to save the table to.
+ * @return Returns true if the table was saved successfully.
+ */
+bool hash_tt_save(char *path);
+
+/*
+ * Load the main transposition table from a file previously created by
+ * hash_tt_save. The table is re-created using the size of the saved
+ * table if needed.
+ *
+ * @param path The file to load the table from.
+ * @return Returns true if the table was loaded successfully. If the
+ *         file is not a valid table file then the table is left unchanged.
+ *         If reading fails after the table has been re-created or
+ *         partially overwritten then the table is cleared.
+ */
+bool hash_tt_load(char *path);
+
 /*
  * Increase the age of the main transposition table.
  */
@@ -71,6 +121,21 @@ void hash_tt_age_table(void);
 void hash_tt_store(struct position *pos, uint32_t move, int depth, int score,
                    int type, int eval_score);
 
+/*
+ * Store an entry received from another process in the main transposition
+ * table. Mate scores must already be adjusted to be relative to the
+ * position, as done by hash_tt_store.
+ *
+ * @param key The key of the position.
+ * @param move The best move found.
+ * @param depth The depth to which the position was searched.
+ * @param score The score for the position.
+ * @param type The type of the score.
+ * @param eval_score The static evaluation of the position.
+ */
+void hash_tt_store_shared(uint64_t key, uint32_t move, int depth, int score,
+                          int type, int eval_score);
+
 /*
  * Lookup the current position in the main transposition table.
  *
@@ -88,7 +153,17 @@ bool hash_tt_lookup(struct position *pos, struct tt_item *item);
 int hash_tt_usage(void);
 
 /*
- * Create the pawn transposition table.
+ * Select if the pawn transposition table should be shared by all workers.
+ * The setting is used the next time pawn transposition tables are created.
+ *
+ * @param shared If a single shared table should be used.
+ */
+void hash_pawntt_set_shared(bool shared);
+
+/*
+ * Create the pawn transposition table. If a shared table is used then
+ * the worker is attached to the shared table, which is created by the
+ * first worker.
  *
  * @param worker The worker.
  * @param size The amount of memory to use for the table (in MB).
@@ -96,7 +171,8 @@ int hash_tt_usage(void);
 void hash_pawntt_create_table(struct search_worker *worker, int size);
 
 /*
- * Destroy the pawn transposition table.
+ * Destroy the pawn transposition table. A shared table is destroyed
+ * when the last worker is detached from it.
  *
  * @param worker The worker.
  */
@@ -134,6 +210,46 @@ void hash_pawntt_store(struct search_worker *worker, struct pawntt_item *item);
  */
 bool hash_pawntt_lookup(struct search_worker *worker, struct pawntt_item *item);
 
+/*
+ * Store a new item in the material transposition table of a worker.
+ *
+ * @param worker The worker.
+ * @param item The item to store. Note that the material signature field is
+ *             ignored, the signature in the board structure is always used.
+ */
+void hash_materialtt_store(struct search_worker *worker,
+                           struct materialtt_item *item);
+
+/*
+ * Lookup the material of the current position in the material
+ * transposition table of a worker.
+ *
+ * @param worker The worker.
+ * @param item Location where the found item is stored.
+ * @return Returns true if the material was found, false otherwise.
+ */
+bool hash_materialtt_lookup(struct search_worker *worker,
+                            struct materialtt_item *item);
+
+/*
+ * Store the static evaluation of the current position in the
+ * evaluation cache of a worker.
+ *
+ * @param worker The worker.
+ * @param score The static evaluation score.
+ */
+void hash_evalcache_store(struct search_worker *worker, int score);
+
+/*
+ * Lookup the static evaluation of the current position in the
+ * evaluation cache of a worker.
+ *
+ * @param worker The worker.
+ * @param score Location where the found score is stored.
+ * @return Returns true if the position was found, false otherwise.
+ */
+bool hash_evalcache_lookup(struct search_worker *worker, int *score);
+
 /*
  * Prefetch hash table entries for a specific position.
  *
@@ -517,6 +517,21 @@ uint64_t key_generate_pawnkey(struct position *pos)
     return key;
 }
 
+uint64_t key_generate_materialkey(struct position *pos)
+{
+    uint64_t key;
+    int      piece;
+
+    assert(valid_position(pos));
+
+    key = 0ULL;
+    for (piece=0;piece<NPIECES;piece++) {
+        key += BITCOUNT(pos->bb_pieces[piece])*MATERIALKEY_UNIT(piece);
+    }
+
+    return key;
+}
+
 uint64_t key_update_piece(uint64_t key, int piece, int sq)
 {
     key ^= piece_values[piece][sq];
@@ -547,3 +562,17 @@ uint64_t key_update_castling(uint64_t key, int old_castle, int new_castle)
     key ^= castle_values[new_castle];
     return key;
 }
+
+uint64_t key_add_material(uint64_t key, int piece)
+{
+    assert(MATERIALKEY_COUNT(key, piece) < 15);
+
+    return key + MATERIALKEY_UNIT(piece);
+}
+
+uint64_t key_remove_material(uint64_t key, int piece)
+{
+    assert(MATERIALKEY_COUNT(key, piece) > 0);
+
+    return key - MATERIALKEY_UNIT(piece);
+}
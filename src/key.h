@@ -22,6 +22,14 @@
 
 #include "chess.h"
 
+/*
+ * The material signature stores the number of pieces of each kind
+ * in four bits per piece. Since the count of every piece is stored
+ * the signature is unique for each material distribution.
+ */
+#define MATERIALKEY_UNIT(p) (1ULL<<(4*(p)))
+#define MATERIALKEY_COUNT(k, p) ((int)(((k)>>(4*(p)))&0xF))
+
 /*
  * Generate a unique key for a chess position.
  *
@@ -38,6 +46,14 @@ uint64_t key_generate(struct position *pos);
  */
 uint64_t key_generate_pawnkey(struct position *pos);
 
+/*
+ * Generate the material signature for a chess position.
+ *
+ * @param pos A chess position.
+ * @return Returns the material signature.
+ */
+uint64_t key_generate_materialkey(struct position *pos);
+
 /*
  * Update a piece in the key.
  *
@@ -77,4 +93,22 @@ uint64_t key_update_side(uint64_t key, int new_color);
  */
 uint64_t key_update_castling(uint64_t key, int old_castle, int new_castle);
 
+/*
+ * Add a piece to the material signature.
+ *
+ * @param key The signature to update.
+ * @param piece The piece to add.
+ * @return Returns the updated signature.
+ */
+uint64_t key_add_material(uint64_t key, int piece);
+
+/*
+ * Remove a piece from the material signature.
+ *
+ * @param key The signature to update.
+ * @param piece The piece to remove.
+ * @return Returns the updated signature.
+ */
+uint64_t key_remove_material(uint64_t key, int piece);
+
 #endif
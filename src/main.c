@@ -36,6 +36,9 @@
 #include "hash.h"
 #include "see.h"
 #include "search.h"
+#include "numa.h"
+#include "cluster.h"
+#include "batch.h"
 
 /* The maximum length of a line in the configuration file */
 #define CFG_MAX_LINE_LENGTH 1024
@@ -71,6 +74,37 @@ static void read_config_file(void)
             tb_init(engine_syzygy_path);
         } else if (sscanf(line, "NUM_THREADS=%d", &int_val) == 1) {
             engine_default_num_threads = CLAMP(int_val, 1, MAX_WORKERS);
+        } else if (sscanf(line, "LARGE_PAGES=%d", &int_val) == 1) {
+            engine_default_large_pages = (int_val != 0);
+        } else if (sscanf(line, "PAWN_HASH_SIZE=%d", &int_val) == 1) {
+            engine_default_pawn_hash_size = CLAMP(int_val, MIN_PAWN_HASH_SIZE,
+                                                  MAX_PAWN_HASH_SIZE);
+        } else if (sscanf(line, "SHARED_PAWN_HASH=%d", &int_val) == 1) {
+            engine_default_shared_pawn_hash = (int_val != 0);
+        } else if (sscanf(line, "NUMA_BIND=%d", &int_val) == 1) {
+            engine_default_numa_bind = (int_val != 0);
+        } else if (sscanf(line, "CPU_AFFINITY=%255s",
+                          engine_default_cpu_affinity) == 1) {
+            /* The specification is stored directly by sscanf */
+        } else if (sscanf(line, "AVOID_SMT=%d", &int_val) == 1) {
+            engine_default_avoid_smt = (int_val != 0);
+        } else if (sscanf(line, "SMP_DEPTH_PATTERN=%15s",
+                          engine_default_depth_pattern) == 1) {
+            /* The pattern name is stored directly by sscanf */
+        } else if (sscanf(line, "SMP_MODE=%15s",
+                          engine_default_smp_mode) == 1) {
+            /* The algorithm name is stored directly by sscanf */
+        } else if (sscanf(line, "CLUSTER_NODES=%d", &int_val) == 1) {
+            engine_default_cluster_nodes = CLAMP(int_val, 1,
+                                                 MAX_CLUSTER_NODES);
+        } else if (sscanf(line, "PARALLEL_MULTIPV=%d", &int_val) == 1) {
+            engine_default_parallel_multipv = (int_val != 0);
+        } else if (sscanf(line, "HASH_FILE=%s", engine_hash_file) == 1) {
+            /* The path is stored directly by sscanf */
+        } else if (sscanf(line, "LOAD_HASH=%d", &int_val) == 1) {
+            engine_load_hash_on_startup = (int_val != 0);
+        } else if (sscanf(line, "SAVE_HASH=%d", &int_val) == 1) {
+            engine_save_hash_on_exit = (int_val != 0);
         }
 
         /* Next line */
@@ -103,9 +137,41 @@ static void print_version(void)
     printf("%s\n", APP_AUTHOR);
 }
 
+static bool run_batch_command(int argc, char *argv[], bool annotate)
+{
+    int      njobs;
+    int      depth;
+    uint64_t nodes;
+    int      k;
+
+    njobs = engine_default_num_threads;
+    depth = 0;
+    nodes = 0ULL;
+    for (k=3;k<argc-1;k+=2) {
+        if (!strcmp(argv[k], "--jobs")) {
+            njobs = atoi(argv[k+1]);
+        } else if (!strcmp(argv[k], "--depth")) {
+            depth = atoi(argv[k+1]);
+        } else if (!strcmp(argv[k], "--nodes")) {
+            nodes = strtoull(argv[k+1], NULL, 10);
+        }
+    }
+    if ((depth <= 0) && (nodes == 0ULL)) {
+        depth = BATCH_DEFAULT_DEPTH;
+    }
+    depth = MIN(depth, MAX_SEARCH_DEPTH);
+
+    njobs = CLAMP(njobs, 1, MAX_WORKERS);
+    if (annotate) {
+        return batch_annotate_pgn(argv[2], njobs, depth, nodes);
+    }
+    return batch_analyze_epd(argv[2], njobs, depth, nodes);
+}
+
 int main(int argc, char *argv[])
 {
     struct gamestate *state;
+    int              nthreads;
 
     /* Register a clean up function */
     atexit(cleanup);
@@ -127,11 +193,25 @@ int main(int argc, char *argv[])
     polybook_open(BOOKFILE_NAME);
 
     /* Setup SMP */
+    numa_init();
     smp_init();
+    smp_set_numa_binding(engine_default_numa_bind);
+    (void)smp_set_cpu_affinity(engine_default_cpu_affinity,
+                               engine_default_avoid_smt);
+    (void)smp_set_depth_pattern(engine_default_depth_pattern);
+    (void)smp_set_mode(engine_default_smp_mode);
+    smp_set_parallel_multipv(engine_default_parallel_multipv);
+    smp_set_pawn_hash(engine_default_pawn_hash_size,
+                      engine_default_shared_pawn_hash);
     smp_create_workers(engine_default_num_threads);
+    cluster_init();
 
     /* Setup main transposition table */
+    hash_tt_set_large_pages(engine_default_large_pages);
     hash_tt_create_table(engine_default_hash_size);
+    if (engine_load_hash_on_startup && (engine_hash_file[0] != '\0')) {
+        (void)hash_tt_load(engine_hash_file);
+    }
 
     /* Handle command line options */
     if ((argc == 2) &&
@@ -143,6 +223,30 @@ int main(int argc, char *argv[])
                 !strncmp(argv[1], "--version", 9))) {
         print_version();
         return 0;
+    } else if ((argc >= 2) && !strcmp(argv[1], "--tt-stress")) {
+        nthreads = (argc > 2)?atoi(argv[2]):4;
+        return test_run_tt_stress(MAX(nthreads, 1))?0:1;
+    } else if ((argc >= 2) && !strcmp(argv[1], "--smp-latency")) {
+        nthreads = (argc > 2)?atoi(argv[2]):engine_default_num_threads;
+        test_run_smp_latency(CLAMP(nthreads, 1, MAX_WORKERS));
+        return 0;
+    } else if ((argc >= 2) && !strcmp(argv[1], "--nps-scaling")) {
+        nthreads = (argc > 2)?atoi(argv[2]):engine_default_num_threads;
+        test_run_nps_scaling(CLAMP(nthreads, 1, MAX_WORKERS));
+        return 0;
+    } else if ((argc == 3) && !strcmp(argv[1], "--cluster-node")) {
+        cluster_node_loop(atoi(argv[2]));
+        return 0;
+    } else if ((argc >= 3) && !strcmp(argv[1], "--analyze-epd")) {
+        return run_batch_command(argc, argv, false)?0:1;
+    } else if ((argc >= 3) && !strcmp(argv[1], "--annotate-pgn")) {
+        return run_batch_command(argc, argv, true)?0:1;
+    } else if ((argc == 2) && !strcmp(argv[1], "--perft-compare")) {
+        return test_run_perft_compare()?0:1;
+    } else if ((argc >= 2) && !strcmp(argv[1], "--time-to-depth")) {
+        nthreads = (argc > 2)?atoi(argv[2]):engine_default_num_threads;
+        test_run_time_to_depth(CLAMP(nthreads, 1, MAX_WORKERS));
+        return 0;
     }
 
     /* Create game state */
@@ -151,12 +255,21 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    /* Start the other processes of the cluster */
+    if (engine_default_cluster_nodes > 1) {
+        (void)cluster_start_nodes(engine_default_cluster_nodes);
+    }
+
     /* Enter the main engine loop */
     engine_loop(state);
+    if (engine_save_hash_on_exit && (engine_hash_file[0] != '\0')) {
+        (void)hash_tt_save(engine_hash_file);
+    }
 
     /* Clean up */
     polybook_close();
     destroy_game_state(state);
+    cluster_destroy();
     smp_destroy_workers();
     smp_destroy();
 
@@ -291,23 +291,26 @@ void gen_moves(struct position *pos, struct movelist *list)
 
 void gen_legal_moves(struct position *pos, struct movelist *list)
 {
-    struct movelist temp_list;
-    int             k;
-    int             count;
-    uint32_t        move;
+    struct movelist  temp_list;
+    struct checkinfo ci;
+    int              k;
+    uint32_t         move;
 
     assert(valid_position(pos));
     assert(list != NULL);
 
+    /*
+     * Generate pseudo-legal moves and remove the moves that leave
+     * the king in check. The check and pin information makes it
+     * possible to do this without making the moves.
+     */
+    board_init_checkinfo(pos, &ci);
     list->size = 0;
-    count = 0;
     gen_moves(pos, &temp_list);
     for (k=0;k<temp_list.size;k++) {
         move = temp_list.moves[k];
-        if (board_make_move(pos, move)) {
-            list->moves[count++] = move;
-            list->size++;
-            board_unmake_move(pos);
+        if (board_is_move_legal(pos, move, &ci)) {
+            list->moves[list->size++] = move;
         }
     }
 }
@@ -31,7 +31,9 @@
 void gen_moves(struct position *pos, struct movelist *list);
 
 /*
- * Generate all legal move for this position.
+ * Generate all legal move for this position. Moves that leave the king
+ * in check are removed using the check and pin information for the
+ * position so no moves are made on the board.
  *
  * @param pos The board structure.
  * @param list The list to store the moves in.
@@ -253,9 +253,11 @@ static bool get_move(struct moveselector *ms, struct search_worker *worker,
 }
 
 void select_init_node(struct moveselector *ms, struct search_worker *worker,
-                      bool tactical_only, bool in_check, uint32_t ttmove)
+                      bool tactical_only, struct checkinfo *ci,
+                      uint32_t ttmove)
 {
     struct position *pos = &worker->pos;
+    bool            in_check = ci->checkers != 0ULL;
 
     ms->phase = PHASE_TT;
     ms->tactical_only = tactical_only;
@@ -268,6 +270,7 @@ void select_init_node(struct moveselector *ms, struct search_worker *worker,
         ms->ttmove = ttmove;
     }
     ms->in_check = in_check;
+    ms->ci = ci;
     ms->idx = 0;
     ms->last_idx = 0;
     ms->nbadtacticals = 0;
@@ -280,7 +283,16 @@ bool select_get_move(struct moveselector *ms, struct search_worker *worker,
 {
     assert(move != NULL);
 
-    return get_move(ms, worker, move);
+    /*
+     * Moves are generated as pseudo-legal moves so skip the
+     * moves that would leave the king in check.
+     */
+    while (get_move(ms, worker, move)) {
+        if (board_is_move_legal(&worker->pos, *move, ms->ci)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 bool select_is_bad_capture_phase(struct moveselector *ms)
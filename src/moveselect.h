@@ -27,14 +27,15 @@
  * @param worker The worker.
  * @param captures_only Flags indicating if only tactical moves i.e., captures
  *                      and promotoions, should be considered.
- * @param in_check Is the side to move in check.
+ * @param ci Check and pin information for the position.
  * @param ttmove Transposition table move for this position.
  */
 void select_init_node(struct moveselector *ms, struct search_worker *worker,
-                      bool tactical_only, bool in_check, uint32_t ttmove);
+                      bool tactical_only, struct checkinfo *ci,
+                      uint32_t ttmove);
 
 /*
- * Get the next move to search.
+ * Get the next move to search. Only legal moves are returned.
  *
  * @param ms The moveselector.
  * @param worker The worker.
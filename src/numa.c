@@ -0,0 +1,477 @@
+/*
+ * Marvin - an UCI/XBoard compatible chess engine
+ * Copyright (C) 2015 Martin Danielsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+#include <assert.h>
+#include <ctype.h>
+#include <string.h>
+
+#include "numa.h"
+#include "utils.h"
+
+#ifdef __linux__
+/*
+ * The memory policy syscall is used directly in order to
+ * avoid a dependency on libnuma.
+ */
+#define NODEMASK_WORDS (MAX_NUMA_NODES/(8*sizeof(unsigned long)))
+
+/* Policies for pinning workers to CPUs */
+#define AFFINITY_COMPACT 0
+#define AFFINITY_SCATTER 1
+#define AFFINITY_LIST    2
+
+/* Nodes that have CPUs available to the engine */
+static int number_of_nodes = 0;
+static int node_ids[MAX_NUMA_NODES];
+static int node_ncpus[MAX_NUMA_NODES];
+static cpu_set_t node_cpus[MAX_NUMA_NODES];
+
+/* All CPUs available to the engine */
+static int total_ncpus = 0;
+static cpu_set_t all_cpus;
+
+/* CPUs that the engine is allowed to run on, regardless of node */
+static cpu_set_t allowed_cpus;
+
+/* The CPUs that workers are pinned to, in the order they are used */
+static int pinned_ncpus = 0;
+static int pinned_cpus[CPU_SETSIZE];
+
+/* Information used to order CPUs when pinning workers */
+struct cpu_info {
+    int cpu;
+    int key[4];
+};
+
+/*
+ * Parse a CPU list as found in sysfs, for instance "0-7,16-23".
+ */
+static void parse_cpu_list(char *str, cpu_set_t *set)
+{
+    char *end;
+    long first;
+    long last;
+    long cpu;
+
+    CPU_ZERO(set);
+    while (*str != '\0') {
+        first = strtol(str, &end, 10);
+        if (end == str) {
+            break;
+        }
+        last = first;
+        str = end;
+        if (*str == '-') {
+            str++;
+            last = strtol(str, &end, 10);
+            str = end;
+        }
+        for (cpu=first;(cpu<=last)&&(cpu<CPU_SETSIZE);cpu++) {
+            CPU_SET(cpu, set);
+        }
+        if (*str != ',') {
+            break;
+        }
+        str++;
+    }
+}
+
+/*
+ * Find the core of a CPU and the rank of the CPU among the hardware
+ * threads of the core. The first thread of a core has rank 0.
+ */
+static void read_cpu_topology(int cpu, int *core, int *smt)
+{
+    FILE      *fp;
+    char      path[128];
+    char      buffer[1024];
+    cpu_set_t siblings;
+    int       k;
+
+    *core = cpu;
+    *smt = 0;
+
+    sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list",
+            cpu);
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        return;
+    }
+    if (fgets(buffer, sizeof(buffer), fp) != NULL) {
+        parse_cpu_list(buffer, &siblings);
+        for (k=0;k<cpu;k++) {
+            if (CPU_ISSET(k, &siblings)) {
+                *core = MIN(*core, k);
+                (*smt)++;
+            }
+        }
+    }
+    fclose(fp);
+}
+
+static int node_of_cpu(int cpu)
+{
+    int node;
+
+    for (node=0;node<number_of_nodes;node++) {
+        if (CPU_ISSET(cpu, &node_cpus[node])) {
+            return node;
+        }
+    }
+    return 0;
+}
+
+static int compare_cpu_info(const void *a, const void *b)
+{
+    const struct cpu_info *info_a = a;
+    const struct cpu_info *info_b = b;
+    int                   k;
+
+    for (k=0;k<4;k++) {
+        if (info_a->key[k] != info_b->key[k]) {
+            return info_a->key[k] - info_b->key[k];
+        }
+    }
+    return info_a->cpu - info_b->cpu;
+}
+
+static void set_memory_policy(void *ptr, uint64_t size, int mode,
+                              unsigned long *nodemask)
+{
+    uintptr_t page_size;
+    uintptr_t start;
+    uintptr_t end;
+
+    page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+    start = (((uintptr_t)ptr+page_size-1)/page_size)*page_size;
+    end = (((uintptr_t)ptr+size)/page_size)*page_size;
+    if (end <= start) {
+        return;
+    }
+
+    /*
+     * The policy is only a hint so a failure is
+     * not a problem, the memory is still usable.
+     */
+    (void)syscall(SYS_mbind, start, end-start, mode, nodemask,
+                  MAX_NUMA_NODES+1, 0);
+}
+#endif
+
+void numa_init(void)
+{
+#ifdef __linux__
+    FILE      *fp;
+    char      path[128];
+    char      buffer[1024];
+    cpu_set_t allowed;
+    cpu_set_t cpus;
+    int       node;
+
+    number_of_nodes = 0;
+    total_ncpus = 0;
+    CPU_ZERO(&all_cpus);
+
+    pinned_ncpus = 0;
+    CPU_ZERO(&allowed_cpus);
+
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0) {
+        return;
+    }
+    allowed_cpus = allowed;
+
+    /*
+     * Find all nodes with CPUs that the engine is allowed to run
+     * on. Nodes with only memory are ignored.
+     */
+    for (node=0;node<MAX_NUMA_NODES;node++) {
+        sprintf(path, "/sys/devices/system/node/node%d/cpulist", node);
+        fp = fopen(path, "r");
+        if (fp == NULL) {
+            continue;
+        }
+        if (fgets(buffer, sizeof(buffer), fp) != NULL) {
+            parse_cpu_list(buffer, &cpus);
+            CPU_AND(&cpus, &cpus, &allowed);
+            if (CPU_COUNT(&cpus) > 0) {
+                node_ids[number_of_nodes] = node;
+                node_ncpus[number_of_nodes] = CPU_COUNT(&cpus);
+                node_cpus[number_of_nodes] = cpus;
+                total_ncpus += CPU_COUNT(&cpus);
+                CPU_OR(&all_cpus, &all_cpus, &cpus);
+                number_of_nodes++;
+            }
+        }
+        fclose(fp);
+    }
+#endif
+}
+
+int numa_number_of_nodes(void)
+{
+#ifdef __linux__
+    return (number_of_nodes > 0)?number_of_nodes:1;
+#else
+    return 1;
+#endif
+}
+
+int numa_node_for_worker(int id)
+{
+#ifdef __linux__
+    int cpu;
+    int node;
+
+    assert(id >= 0);
+
+    if (number_of_nodes <= 1) {
+        return 0;
+    }
+
+    /* Pinned workers run on the node of their CPU */
+    if (pinned_ncpus > 0) {
+        return node_of_cpu(pinned_cpus[id%pinned_ncpus]);
+    }
+
+    cpu = id%total_ncpus;
+    for (node=0;node<number_of_nodes-1;node++) {
+        if (cpu < node_ncpus[node]) {
+            break;
+        }
+        cpu -= node_ncpus[node];
+    }
+    return node;
+#else
+    (void)id;
+    return 0;
+#endif
+}
+
+void numa_bind_thread(int node)
+{
+#ifdef __linux__
+    assert(node < numa_number_of_nodes());
+
+    if (number_of_nodes <= 1) {
+        return;
+    }
+
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                                 (node >= 0)?&node_cpus[node]:&all_cpus);
+#else
+    (void)node;
+#endif
+}
+
+void numa_place_memory(void *ptr, uint64_t size, int node)
+{
+#ifdef __linux__
+    unsigned long nodemask[NODEMASK_WORDS+1] = {0};
+    int           id;
+
+    assert((node >= 0) && (node < numa_number_of_nodes()));
+
+    if (number_of_nodes <= 1) {
+        return;
+    }
+
+    id = node_ids[node];
+    nodemask[id/(8*sizeof(unsigned long))] |=
+                                        1UL << (id%(8*sizeof(unsigned long)));
+    set_memory_policy(ptr, size, MPOL_PREFERRED, nodemask);
+#else
+    (void)ptr;
+    (void)size;
+    (void)node;
+#endif
+}
+
+void numa_interleave_memory(void *ptr, uint64_t size)
+{
+#ifdef __linux__
+    unsigned long nodemask[NODEMASK_WORDS+1] = {0};
+    int           id;
+    int           k;
+
+    if (number_of_nodes <= 1) {
+        return;
+    }
+
+    for (k=0;k<number_of_nodes;k++) {
+        id = node_ids[k];
+        nodemask[id/(8*sizeof(unsigned long))] |=
+                                        1UL << (id%(8*sizeof(unsigned long)));
+    }
+    set_memory_policy(ptr, size, MPOL_INTERLEAVE, nodemask);
+#else
+    (void)ptr;
+    (void)size;
+#endif
+}
+
+bool numa_set_cpu_affinity(char *spec, bool avoid_smt)
+{
+#ifdef __linux__
+    struct cpu_info *info;
+    cpu_set_t       cpus;
+    int             policy;
+    int             ninfo;
+    int             node;
+    int             core;
+    int             smt;
+    int             cpu;
+    int             k;
+    int             l;
+
+    assert(spec != NULL);
+
+    /* Parse the specification */
+    if (!strncmp(spec, "none", 4)) {
+        pinned_ncpus = 0;
+        return true;
+    } else if (!strncmp(spec, "compact", 7)) {
+        policy = AFFINITY_COMPACT;
+        cpus = allowed_cpus;
+    } else if (!strncmp(spec, "scatter", 7)) {
+        policy = AFFINITY_SCATTER;
+        cpus = allowed_cpus;
+    } else if (isdigit((unsigned char)*spec)) {
+        policy = AFFINITY_LIST;
+        parse_cpu_list(spec, &cpus);
+        CPU_AND(&cpus, &cpus, &allowed_cpus);
+    } else {
+        return false;
+    }
+    if (CPU_COUNT(&cpus) == 0) {
+        return false;
+    }
+
+    /* Calculate the sort keys for all CPUs */
+    info = malloc(CPU_COUNT(&cpus)*sizeof(struct cpu_info));
+    if (info == NULL) {
+        return false;
+    }
+    ninfo = 0;
+    for (cpu=0;cpu<CPU_SETSIZE;cpu++) {
+        if (!CPU_ISSET(cpu, &cpus)) {
+            continue;
+        }
+        node = node_of_cpu(cpu);
+        read_cpu_topology(cpu, &core, &smt);
+        info[ninfo].cpu = cpu;
+        switch (policy) {
+        case AFFINITY_COMPACT:
+            /* Fill one node and one core at a time */
+            info[ninfo].key[0] = avoid_smt?smt:0;
+            info[ninfo].key[1] = node;
+            info[ninfo].key[2] = core;
+            info[ninfo].key[3] = smt;
+            break;
+        case AFFINITY_SCATTER:
+            /*
+             * Spread workers over all nodes and cores before
+             * the second thread of any core is used.
+             */
+            info[ninfo].key[0] = smt;
+            info[ninfo].key[1] = 0;
+            info[ninfo].key[2] = node;
+            info[ninfo].key[3] = core;
+            break;
+        case AFFINITY_LIST:
+        default:
+            info[ninfo].key[0] = avoid_smt?smt:0;
+            info[ninfo].key[1] = 0;
+            info[ninfo].key[2] = 0;
+            info[ninfo].key[3] = 0;
+            break;
+        }
+        ninfo++;
+    }
+
+    /*
+     * For the scatter policy the second key is the rank of the core
+     * within its node, which makes consecutive workers alternate
+     * between nodes.
+     */
+    if (policy == AFFINITY_SCATTER) {
+        for (k=0;k<ninfo;k++) {
+            for (l=0;l<ninfo;l++) {
+                if ((info[l].key[0] == info[k].key[0]) &&
+                    (info[l].key[2] == info[k].key[2]) &&
+                    (info[l].key[3] < info[k].key[3])) {
+                    info[k].key[1]++;
+                }
+            }
+        }
+    }
+
+    qsort(info, ninfo, sizeof(struct cpu_info), compare_cpu_info);
+    for (k=0;k<ninfo;k++) {
+        pinned_cpus[k] = info[k].cpu;
+    }
+    pinned_ncpus = ninfo;
+    free(info);
+
+    return true;
+#else
+    (void)avoid_smt;
+    return !strncmp(spec, "none", 4) || !strncmp(spec, "compact", 7) ||
+           !strncmp(spec, "scatter", 7) || isdigit((unsigned char)*spec);
+#endif
+}
+
+int numa_cpu_for_worker(int id)
+{
+#ifdef __linux__
+    assert(id >= 0);
+
+    return (pinned_ncpus > 0)?pinned_cpus[id%pinned_ncpus]:-1;
+#else
+    (void)id;
+    return -1;
+#endif
+}
+
+void numa_pin_thread(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+
+    if (cpu < 0) {
+        if (CPU_COUNT(&allowed_cpus) == 0) {
+            return;
+        }
+        set = allowed_cpus;
+    } else {
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+    }
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+#else
+    (void)cpu;
+#endif
+}
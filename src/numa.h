@@ -0,0 +1,113 @@
+/*
+ * Marvin - an UCI/XBoard compatible chess engine
+ * Copyright (C) 2015 Martin Danielsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The maximum number of NUMA nodes that are supported */
+#define MAX_NUMA_NODES 64
+
+/*
+ * Detect the NUMA topology of the machine. On systems where the topology
+ * cannot be detected the machine is treated as having a single node.
+ */
+void numa_init(void);
+
+/*
+ * Get the number of NUMA nodes that have CPUs available to the engine.
+ *
+ * @return Returns the number of nodes.
+ */
+int numa_number_of_nodes(void);
+
+/*
+ * Get the node that a worker should run on. Nodes are filled one at a
+ * time so that a small number of workers share the same node.
+ *
+ * @param id The id of the worker.
+ * @return Returns the index of the node (0..numa_number_of_nodes()-1).
+ */
+int numa_node_for_worker(int id);
+
+/*
+ * Bind the calling thread to the CPUs of a node.
+ *
+ * @param node The index of the node. A negative value allows the thread
+ *             to run on all CPUs that are available to the engine.
+ */
+void numa_bind_thread(int node);
+
+/*
+ * Request that memory is placed on a specific node. The request must be
+ * made before the memory is first touched. Only whole pages inside the
+ * memory area are affected.
+ *
+ * @param ptr The start of the memory area.
+ * @param size The size of the memory area.
+ * @param node The index of the node.
+ */
+void numa_place_memory(void *ptr, uint64_t size, int node);
+
+/*
+ * Request that memory is interleaved page by page across all nodes. The
+ * request must be made before the memory is first touched. Only whole
+ * pages inside the memory area are affected.
+ *
+ * @param ptr The start of the memory area.
+ * @param size The size of the memory area.
+ */
+void numa_interleave_memory(void *ptr, uint64_t size);
+
+/*
+ * Configure how workers are pinned to individual CPUs. The following
+ * specifications are supported:
+ * - none: workers are not pinned
+ * - compact: workers are packed on as few nodes and cores as possible
+ * - scatter: workers are spread over all nodes and cores
+ * - a list of CPUs, for instance "0-7,16-23": workers are pinned to the
+ *   listed CPUs in order
+ * If there are more workers than CPUs then the CPUs are reused.
+ *
+ * @param spec The pinning specification.
+ * @param avoid_smt If the second hardware thread of a core should only be
+ *                  used after all cores have a worker. This is always the
+ *                  case for the scatter policy.
+ * @return Returns false if the specification is invalid or doesn't
+ *         contain any usable CPUs.
+ */
+bool numa_set_cpu_affinity(char *spec, bool avoid_smt);
+
+/*
+ * Get the CPU that a worker is pinned to.
+ *
+ * @param id The id of the worker.
+ * @return Returns the CPU, or -1 if workers are not pinned.
+ */
+int numa_cpu_for_worker(int id);
+
+/*
+ * Pin the calling thread to a CPU.
+ *
+ * @param cpu The CPU. A negative value allows the thread to run on all
+ *            CPUs that are available to the engine.
+ */
+void numa_pin_thread(int cpu);
+
+#endif
@@ -223,7 +223,7 @@ static bool probe_wdl_tables(struct search_worker *worker, int alpha, int beta,
         *score = 0;
         return false;
     }
-    worker->tbhits++;
+    STATS_INC(worker->stats.tbhits);
 
     switch (res) {
     case TB_WIN:
@@ -269,25 +269,27 @@ static void update_pv(struct search_worker *worker, uint32_t move)
 static void checkup(struct search_worker *worker)
 {
     /* Check if the worker is requested to stop */
-    if (smp_should_stop()) {
+    if (smp_should_stop(worker)) {
         longjmp(worker->env, EXCEPTION_STOP);
     }
 
     /*
-     * For the master worker also check if the time
-     * is up or if a new command have been received.
+     * For the master worker also check if the time or node
+     * limit is reached or if a new command have been received.
      */
-    if ((worker->id != 0) || !CHECKUP(worker->nodes)) {
+    if ((worker->id != 0) || !CHECKUP(STATS_GET(worker->stats.nodes))) {
         return;
     }
 
     /* Perform checkup */
-    if (!tc_check_time(worker)) {
-        smp_stop_all();
+    if (!tc_check_time(worker) ||
+        ((worker->state->max_nodes > 0) &&
+         (STATS_GET(worker->stats.nodes) >= worker->state->max_nodes))) {
+        smp_stop_search(worker);
         longjmp(worker->env, EXCEPTION_TIMEOUT);
     }
-    if (engine_check_input(worker)) {
-        smp_stop_all();
+    if (!worker->isolated && engine_check_input(worker)) {
+        smp_stop_search(worker);
         longjmp(worker->env, EXCEPTION_COMMAND);
     }
 }
@@ -320,18 +322,21 @@ static int quiescence(struct search_worker *worker, int depth, int alpha,
     int                 score;
     int                 best_score;
     int                 static_score;
+    int                 tt_flag;
     uint32_t            move;
+    uint32_t            best_move;
     bool                found_move;
     bool                in_check;
     bool                tt_found;
     struct tt_item      tt_item;
+    struct checkinfo    ci;
     struct position     *pos = &worker->pos;
     struct moveselector ms;
 
     /* Update search statistics */
     if (depth < 0) {
-        worker->nodes++;
-        worker->qnodes++;
+        STATS_INC(worker->stats.nodes);
+        STATS_INC(worker->stats.qnodes);
     }
 
     /* Check if the time is up or if we have received a new command */
@@ -345,8 +350,20 @@ static int quiescence(struct search_worker *worker, int depth, int alpha,
         return 0;
     }
 
-    /* Evaluate the position */
-    static_score = eval_evaluate(pos);
+    /* Check if the position have been searched before */
+    tt_found = hash_tt_lookup(pos, &tt_item);
+    if (tt_found) {
+        score = adjust_mate_score(pos, tt_item.score);
+        if (check_tt_cutoff(&tt_item, 0, alpha, beta, score)) {
+            return score;
+        }
+    }
+
+    /*
+     * Evaluate the position. If the position was found in the
+     * transposition table then the stored evaluation is used.
+     */
+    static_score = tt_found?tt_item.eval_score:eval_evaluate(pos);
 
     /* If we have reached the maximum depth then we stop */
     if (pos->sply >= MAX_PLY) {
@@ -362,26 +379,24 @@ static int quiescence(struct search_worker *worker, int depth, int alpha,
     best_score = -INFINITE_SCORE;
     if (!in_check) {
         best_score = static_score;
-        if (static_score >= beta) {
-            return static_score;
+        if (best_score >= beta) {
+            if (!tt_found) {
+                hash_tt_store(pos, NOMOVE, TT_QUIESCENCE_DEPTH, best_score,
+                              TT_BETA, static_score);
+            }
+            return best_score;
         }
-        if (static_score > alpha) {
-            alpha = static_score;
+        if (best_score > alpha) {
+            alpha = best_score;
         }
     }
 
-    /* Check if the position have been searched before */
-    tt_found = hash_tt_lookup(pos, &tt_item);
-    if (tt_found) {
-        score = adjust_mate_score(pos, tt_item.score);
-        if (check_tt_cutoff(&tt_item, 0, alpha, beta, score)) {
-            return score;
-        }
-    }
-    
     /* Search all moves */
+    board_init_checkinfo(pos, &ci);
+    tt_flag = TT_ALPHA;
+    best_move = NOMOVE;
     found_move = false;
-    select_init_node(&ms, worker, true, in_check, tt_found?tt_item.move:NOMOVE);
+    select_init_node(&ms, worker, true, &ci, tt_found?tt_item.move:NOMOVE);
     while (select_get_move(&ms, worker, &move)) {
         /*
          * Don't bother searching captures that
@@ -401,16 +416,14 @@ static int quiescence(struct search_worker *worker, int depth, int alpha,
         if (!in_check &&
             board_has_non_pawn(pos, FLIP_COLOR(pos->stm)) &&
             !is_pawn_push(pos, move) &&
-            !board_move_gives_check(pos, move)) {
+            !board_move_gives_check(pos, move, &ci)) {
             if ((static_score+material_gain(pos, move)+DELTA_MARGIN) < alpha) {
                 continue;
             }
         }
 
         /* Recursivly search the move */
-        if (!board_make_move(pos, move)) {
-            continue;
-        }
+        board_make_legal_move(pos, move);
         found_move = true;
         score = -quiescence(worker, depth-1, -beta, -alpha);
         board_unmake_move(pos);
@@ -418,10 +431,13 @@ static int quiescence(struct search_worker *worker, int depth, int alpha,
         /* Check if we have found a better move */
         if (score > best_score) {
             best_score = score;
+            best_move = move;
             if (score > alpha) {
                 if (score >= beta) {
+                    tt_flag = TT_BETA;
                     break;
                 }
+                tt_flag = TT_EXACT;
                 alpha = score;
                 update_pv(worker, move);
             }
@@ -432,7 +448,34 @@ static int quiescence(struct search_worker *worker, int depth, int alpha,
      * In case the side to move is in check the all all moves are generated
      * so if no legal move was found then it must be checkmate.
      */
-    return (in_check && !found_move)?-CHECKMATE+pos->sply:best_score;
+    if (in_check && !found_move) {
+        tt_flag = TT_EXACT;
+        best_score = -CHECKMATE + pos->sply;
+    }
+
+    /* Store the result for this node in the transposition table */
+    hash_tt_store(pos, best_move, TT_QUIESCENCE_DEPTH, best_score, tt_flag,
+                  static_score);
+
+    return best_score;
+}
+
+/*
+ * Get the next move to search. When all moves have been returned by the
+ * move selector the moves that were deferred by ABDADA are returned.
+ */
+static bool next_move(struct moveselector *ms, struct search_worker *worker,
+                      struct movelist *deferred, int *deferred_idx,
+                      uint32_t *move)
+{
+    if ((*deferred_idx == 0) && select_get_move(ms, worker, move)) {
+        return true;
+    }
+    if (*deferred_idx < deferred->size) {
+        *move = deferred->moves[(*deferred_idx)++];
+        return true;
+    }
+    return false;
 }
 
 static int search(struct search_worker *worker, int depth, int alpha, int beta,
@@ -460,9 +503,14 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
     int                 new_depth;
     struct tt_item      tt_item;
     bool                tt_found;
+    struct checkinfo    ci;
     struct position     *pos = &worker->pos;
     bool                is_singular;
     struct movelist     quiets;
+    struct movelist     deferred;
+    int                 deferred_idx;
+    bool                abdada;
+    uint64_t            node_key;
     int                 see_prune_margin[2];
     int                 hist;
     int                 chist;
@@ -477,7 +525,7 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
     see_prune_margin[1] = SEE_TACTICAL_MARGIN(depth);
 
     /* Update search statistics */
-    worker->nodes++;
+    STATS_INC(worker->stats.nodes);
 
     /* Check if we have reached the full depth of the search */
     if ((depth <= 0) || (pos->sply >= MAX_SEARCH_DEPTH)) {
@@ -488,12 +536,13 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
     checkup(worker);
 
     /* Check if the selective depth should be updated */
-    if (pos->sply > worker->seldepth) {
-        worker->seldepth = pos->sply;
+    if (pos->sply > worker->stats.seldepth) {
+        worker->stats.seldepth = pos->sply;
     }
 
     /* Reset the search tree for this ply */
     worker->pv_table[pos->sply].size = 0;
+    SEARCH_STAT_INC(worker, SSTAT_NODES, depth);
 
     /*
      * Check if the game should be considered a draw. A position is
@@ -515,11 +564,14 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
     tt_move = NOMOVE;
     tt_score = 0; 
     tt_found = hash_tt_lookup(pos, &tt_item);
+    SEARCH_STAT_INC(worker, SSTAT_TT_PROBES, depth);
     if (tt_found) {
+        SEARCH_STAT_INC(worker, SSTAT_TT_HITS, depth);
         tt_move = tt_item.move;
         tt_score = adjust_mate_score(pos, tt_item.score);
         if (!pv_node && (tt_move != exclude_move) &&
             check_tt_cutoff(&tt_item, depth, alpha, beta, tt_score)) {
+            SEARCH_STAT_INC(worker, SSTAT_TT_CUTOFFS, depth);
             return tt_score;
         }
     }
@@ -537,17 +589,19 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
      * to use for pruning decisions.
      */
     static_score = tt_found?tt_item.eval_score:eval_evaluate(pos);
-    pos->eval_stack[pos->sply] = static_score;
+    worker->eval_stack[pos->sply] = static_score;
     bool improving = (pos->sply >= 2 &&
-                    static_score > pos->eval_stack[pos->sply-2]);
+                    static_score > worker->eval_stack[pos->sply-2]);
 
     /* Reverse futility pruning */
-    in_check = board_in_check(pos, pos->stm);
+    board_init_checkinfo(pos, &ci);
+    in_check = ci.checkers != 0ULL;
     if ((depth <= FUTILITY_DEPTH) &&
         !in_check &&
         !pv_node &&
         board_has_non_pawn(pos, pos->stm) &&
         ((static_score-futility_margin[depth]) >= beta)) {
+        SEARCH_STAT_INC(worker, SSTAT_RFP_PRUNES, depth);
         return static_score;
     }
 
@@ -561,13 +615,16 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
         (tt_move == NOMOVE) &&
         (depth <= RAZORING_DEPTH) &&
         ((static_score+razoring_margin[depth]) <= alpha)) {
+        SEARCH_STAT_INC(worker, SSTAT_RAZOR_TRIES, depth);
         if (depth == 1) {
+            SEARCH_STAT_INC(worker, SSTAT_RAZOR_CUTOFFS, depth);
             return quiescence(worker, 0, alpha, beta);
         }
 
         threshold = alpha - razoring_margin[depth];
         score = quiescence(worker, 0, threshold, threshold+1);
         if (score <= threshold) {
+            SEARCH_STAT_INC(worker, SSTAT_RAZOR_CUTOFFS, depth);
             return score;
         }
     }
@@ -582,6 +639,7 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
         !in_check &&
         (depth > NULLMOVE_DEPTH) &&
         board_has_non_pawn(pos, pos->stm)) {
+        SEARCH_STAT_INC(worker, SSTAT_NULL_TRIES, depth);
         reduction = NULLMOVE_BASE_REDUCTION + depth/NULLMOVE_DIVISOR;
         board_make_null_move(pos);
         score = -search(worker, depth-reduction-1, -beta, -beta+1, false,
@@ -593,6 +651,7 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
              * score doesn't necessarilly indicate a forced mate. So
              * return beta instead in this case.
              */
+            SEARCH_STAT_INC(worker, SSTAT_NULL_CUTOFFS, depth);
             return score < KNOWN_WIN?score:beta;
         }
     }
@@ -606,7 +665,7 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
         board_has_non_pawn(&worker->pos, pos->stm)) {
         threshold = beta + PROBCUT_MARGIN;
 
-        select_init_node(&ms, worker, true, in_check, tt_move);
+        select_init_node(&ms, worker, true, &ci, tt_move);
         while (select_get_move(&ms, worker, &move)) {
             /*
              * Skip non-captures and captures that are not
@@ -623,13 +682,13 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
             }
 
             /* Search the move */
-            if (!board_make_move(pos, move)) {
-                continue;
-            }
+            SEARCH_STAT_INC(worker, SSTAT_PROBCUT_TRIES, depth);
+            board_make_legal_move(pos, move);
             score = -search(worker, depth-PROBCUT_DEPTH+1, -threshold,
                             -threshold+1, true, NOMOVE);
             board_unmake_move(pos);
             if (score >= threshold) {
+                SEARCH_STAT_INC(worker, SSTAT_PROBCUT_CUTOFFS, depth);
                 return score;
             }
         }
@@ -646,8 +705,10 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
         board_is_move_pseudo_legal(pos, tt_move)) {
         threshold = tt_score-2*depth;
 
+        SEARCH_STAT_INC(worker, SSTAT_SE_TRIES, depth);
         score = search(worker, depth/2, threshold-1, threshold, true, tt_move);
         if (score < threshold) {
+            SEARCH_STAT_INC(worker, SSTAT_SE_EXTENSIONS, depth);
             is_singular = true;
         }
     }
@@ -671,8 +732,12 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
     tt_flag = TT_ALPHA;
     movenumber = 0;
     found_move = false;
-    select_init_node(&ms, worker, false, in_check, tt_move);
-    while (select_get_move(&ms, worker, &move)) {
+    abdada = smp_abdada_enabled(worker);
+    node_key = pos->key;
+    deferred.size = 0;
+    deferred_idx = 0;
+    select_init_node(&ms, worker, false, &ci, tt_move);
+    while (next_move(&ms, worker, &deferred, &deferred_idx, &move)) {
         /*
          * If this a singular extension search then skip the move
          * that is expected to be singular.
@@ -682,12 +747,12 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
         }
 
         /* Various move properties */
-        gives_check = board_move_gives_check(pos, move);
+        gives_check = board_move_gives_check(pos, move, &ci);
         tactical = ISTACTICAL(move) || in_check || gives_check;
         history_get_scores(worker, move, &hist, &chist, &fhist);
 
         /* Remeber all quiet moves */
-        if (!ISTACTICAL(move)) {
+        if (!ISTACTICAL(move) && (deferred_idx == 0)) {
             quiets.moves[quiets.size++] = move;
         }
 
@@ -698,6 +763,7 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
              * tactical ones.
              */
             if (futility_pruning && !tactical) {
+                SEARCH_STAT_INC(worker, SSTAT_FUTILITY_PRUNES, depth);
                 continue;
             }
 
@@ -711,21 +777,25 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
                 (movenumber > lmp_counts[depth]) &&
                 (abs(alpha) < KNOWN_WIN) &&
                 !tactical) {
+                SEARCH_STAT_INC(worker, SSTAT_LMP_PRUNES, depth);
                 continue;
             }
 
             /* Prune moves that lose material according to SEE */
             if (depth < SEE_PRUNE_DEPTH &&
                 !see_ge(pos, move, see_prune_margin[tactical])) {
+                SEARCH_STAT_INC(worker, SSTAT_SEE_PRUNES, depth);
                 continue;
             }
 
             /* Prune moves based on continuation history */
             if (!tactical && (depth <= HISTORY_PRUNING_DEPTH)) {
                 if (chist < counter_history_pruning_margin[depth]) {
+                    SEARCH_STAT_INC(worker, SSTAT_HISTORY_PRUNES, depth);
                     continue;
                 }
                 if (fhist < followup_history_pruning_margin[depth]) {
+                    SEARCH_STAT_INC(worker, SSTAT_HISTORY_PRUNES, depth);
                     continue;
                 }
             }
@@ -756,12 +826,24 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
             extended = true;
         }
 
-        /* Make the move */
-        if (!board_make_move(pos, move)) {
+        /*
+         * With ABDADA, moves other than the first one are deferred
+         * if another worker is already searching them. Deferred moves
+         * are searched after all other moves.
+         */
+        if (abdada && (movenumber > 0) && (deferred_idx == 0) &&
+            smp_abdada_defer_move(node_key, move, depth)) {
+            deferred.moves[deferred.size++] = move;
             continue;
         }
+
+        /* Make the move */
+        board_make_legal_move(pos, move);
         movenumber++;
         found_move = true;
+        if (abdada) {
+            smp_abdada_start_move(node_key, move, depth);
+        }
 
         /*
          * LMR (Late Move Reduction). With good move ordering later moves
@@ -786,11 +868,15 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
             score = -search(worker, new_depth-1, -beta, -alpha, true, NOMOVE);
         } else {
             /* Perform a reduced depth search with a zero window */
+            if (reduction > 0) {
+                SEARCH_STAT_INC(worker, SSTAT_LMR_SEARCHES, depth);
+            }
             score = -search(worker, new_depth-reduction-1, -alpha-1, -alpha,
                             true, NOMOVE);
 
             /* Re-search with full depth if the move improved alpha */
             if ((score > alpha) && (reduction > 0)) {
+                SEARCH_STAT_INC(worker, SSTAT_LMR_RESEARCHES, depth);
                 score = -search(worker, new_depth-1, -alpha-1, -alpha, true,
                                 NOMOVE);
             }
@@ -806,6 +892,9 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
             }
         }
         board_unmake_move(pos);
+        if (abdada) {
+            smp_abdada_finish_move(node_key, move, depth);
+        }
 
         /* Check if we have found a new best move */
         if (score > best_score) {
@@ -828,6 +917,11 @@ static int search(struct search_worker *worker, int depth, int alpha, int beta,
                         killer_add_move(worker, move);
                         counter_add_move(worker, move);
                     }
+                    SEARCH_STAT_INC(worker, SSTAT_FAIL_HIGHS, depth);
+                    if (movenumber == 1) {
+                        SEARCH_STAT_INC(worker, SSTAT_FIRST_MOVE_FAIL_HIGHS,
+                                        depth);
+                    }
                     tt_flag = TT_BETA;
                     break;
                 }
@@ -876,11 +970,11 @@ static int search_root(struct search_worker *worker, int depth, int alpha,
     uint32_t            best_move;
     int                 tt_flag;
     struct position     *pos = &worker->pos;
-    int                 in_check;
     int                 new_depth;
     struct movelist     quiets;
     bool                tt_found;
     struct tt_item      tt_item;
+    struct checkinfo    ci;
     struct moveselector ms;
 
     /* Check if the time is up or if we have received a new command */
@@ -892,17 +986,17 @@ static int search_root(struct search_worker *worker, int depth, int alpha,
     /* Check the transposition table and initialize some helper variables */
     tt_found = hash_tt_lookup(pos, &tt_item);
     best_move = tt_found?tt_item.move:NOMOVE;
-    in_check = board_in_check(pos, pos->stm);
+    board_init_checkinfo(pos, &ci);
 
     /* Remember the static evaluation of this positin */
-    pos->eval_stack[pos->sply] = eval_evaluate(pos);
+    worker->eval_stack[pos->sply] = eval_evaluate(pos);
 
     /* Search all moves */
     quiets.size = 0;
     tt_flag = TT_ALPHA;
     best_score = -INFINITE_SCORE;
-    worker->currmovenumber = 0;
-    select_init_node(&ms, worker, false, in_check, best_move);
+    worker->stats.currmovenumber = 0;
+    select_init_node(&ms, worker, false, &ci, best_move);
     while (select_get_move(&ms, worker, &move)) {
         if ((worker->multipv > 1) && is_multipv_move(worker, move)) {
             continue;
@@ -913,8 +1007,8 @@ static int search_root(struct search_worker *worker, int depth, int alpha,
         }
 
         /* Send stats for the first worker */
-        worker->currmovenumber++;
-        worker->currmove = move;
+        worker->stats.currmovenumber++;
+        worker->stats.currmove = move;
         if (worker->id == 0)  {
             engine_send_move_info(worker);
         }
@@ -925,9 +1019,7 @@ static int search_root(struct search_worker *worker, int depth, int alpha,
         }
 
         /* Make the move */
-        if (!board_make_move(pos, move)) {
-            continue;
-        }
+        board_make_legal_move(pos, move);
 
         /* Extend checking moves */
         new_depth = depth;
@@ -939,7 +1031,7 @@ static int search_root(struct search_worker *worker, int depth, int alpha,
         score = -search(worker, new_depth-1, -beta, -alpha, true, NOMOVE);
         board_unmake_move(pos);
 
-        if ((worker->currmovenumber == 1) && (score <= alpha)) {
+        if ((worker->stats.currmovenumber == 1) && (score <= alpha)) {
             worker->resolving_tt_fail = true;
         }
 
@@ -984,14 +1076,15 @@ static int search_root(struct search_worker *worker, int depth, int alpha,
                         &worker->mpv_lines[worker->mpvidx].pv);
                 worker->mpv_lines[worker->mpvidx].score = score;
                 worker->mpv_lines[worker->mpvidx].depth = worker->depth;
-                worker->mpv_lines[worker->mpvidx].seldepth = worker->seldepth;
+                worker->mpv_lines[worker->mpvidx].seldepth =
+                                                    worker->stats.seldepth;
                 if ((worker->id == 0) && (worker->multipv == 1)) {
                     engine_send_pv_info(worker, score);
                 }
                 if (worker->resolving_tt_fail) {
                     worker->resolving_tt_fail = false;
                     if (!tc_check_time(worker)) {
-                        smp_stop_all();
+                        smp_stop_search(worker);
                         break;
                     }
                 }
@@ -1039,7 +1132,7 @@ static void search_aspiration_window(struct search_worker *worker, int depth,
     while (true) {
 		/* Search */
         worker->depth = depth;
-        worker->seldepth = 0;
+        worker->stats.seldepth = 0;
         alpha = MAX(alpha, -INFINITE_SCORE);
         beta = MIN(beta, INFINITE_SCORE);
         score = search_root(worker, depth, alpha, beta);
@@ -1070,28 +1163,111 @@ static void search_aspiration_window(struct search_worker *worker, int depth,
     }
 }
 
-void search_init(void)
+static int search_root_move(struct search_worker *worker, uint32_t move,
+                            int depth, int alpha)
 {
-    int k;
-    int l;
+    struct position *pos = &worker->pos;
+    int             new_depth;
+    int             score;
 
-    for (k=1;k<64;k++) {
-        for (l=1;l<64;l++) {
-            lmr_reductions[k][l] = 0.5 + log(k)*log(l)/2.0;
+    /* Check if the time is up or if we have received a new command */
+    checkup(worker);
+
+    /* Reset the search tree for this ply */
+    worker->pv_table[0].size = 0;
+
+    /* Remember the static evaluation of this positin */
+    worker->eval_stack[pos->sply] = eval_evaluate(pos);
+
+    /* Make the move */
+    if (!board_make_move(pos, move)) {
+        return -INFINITE_SCORE;
+    }
+
+    /* Extend checking moves */
+    new_depth = depth;
+    if (board_in_check(pos, pos->stm)) {
+        new_depth++;
+    }
+
+    /*
+     * Search the move with an open upper bound so that
+     * the score is exact if it is above the lower bound.
+     */
+    score = -search(worker, new_depth-1, -INFINITE_SCORE, -alpha, true,
+                    NOMOVE);
+    board_unmake_move(pos);
+    if (score > alpha) {
+        update_pv(worker, move);
+    }
+
+    return score;
+}
+
+static void search_split_root(struct search_worker *worker)
+{
+    int      depth;
+    int      prev_depth;
+    int      idx;
+    int      alpha;
+    int      score;
+    uint32_t move;
+
+    /* Handle aborted searches */
+    if (setjmp(worker->env) != 0) {
+        return;
+    }
+
+    prev_depth = smp_root_depth();
+    while (!smp_should_stop(worker)) {
+        /*
+         * When an iteration has been completed the master
+         * checks if there is time for a new iteration.
+         */
+        depth = smp_root_depth();
+        if ((worker->id == 0) && (depth != prev_depth)) {
+            worker->depth = prev_depth;
+            if (!tc_new_iteration(worker)) {
+                smp_stop_search(worker);
+                break;
+            }
         }
+        prev_depth = depth;
+        worker->depth = depth;
+
+        /* Claim a root move from the shared table and search it */
+        idx = smp_root_get_move(depth, &move, &alpha);
+        if (idx >= 0) {
+            worker->stats.seldepth = 0;
+            worker->stats.currmovenumber = idx + 1;
+            worker->stats.currmove = move;
+            score = search_root_move(worker, move, depth, alpha);
+            smp_root_put_result(worker, idx, alpha, score);
+            continue;
+        }
+
+        /*
+         * All moves of the iteration have been claimed so wait for
+         * the other workers to finish. The master keeps checking the
+         * time and for new commands while waiting.
+         */
+        if ((worker->id == 0) &&
+            (!tc_check_time(worker) || engine_check_input(worker))) {
+            smp_stop_search(worker);
+            break;
+        }
+        sleep_ms(1);
     }
 }
 
-void search_find_best_move(struct search_worker *worker)
+static void search_iterative_deepening(struct search_worker *worker)
 {
     int score;
     int depth;
     int mpvidx;
 
-    assert(valid_position(&worker->pos));
-
     /* Setup the first iteration */
-    depth = 1 + worker->id%2;
+    depth = smp_first_depth(worker);
 
     /* Main search loop */
     score = 0;
@@ -1122,14 +1298,14 @@ void search_find_best_move(struct search_worker *worker)
          */
         if (worker->state->exit_on_mate && !worker->state->pondering) {
             if ((score > KNOWN_WIN) || (score < (-KNOWN_WIN))) {
-                smp_stop_all();
+                smp_stop_search(worker);
                 break;
             }
         }
 
         /* Check if the worker has reached the maximum depth */
         if (depth > worker->state->sd) {
-            smp_stop_all();
+            smp_stop_search(worker);
             break;
         }
 
@@ -1143,10 +1319,37 @@ void search_find_best_move(struct search_worker *worker)
 
         /* Check if the is time for a new iteration */
         if (!tc_new_iteration(worker)) {
-            smp_stop_all();
+            smp_stop_search(worker);
             break;
         }
     }
+}
+
+void search_init(void)
+{
+    int k;
+    int l;
+
+    for (k=1;k<64;k++) {
+        for (l=1;l<64;l++) {
+            lmr_reductions[k][l] = 0.5 + log(k)*log(l)/2.0;
+        }
+    }
+}
+
+void search_find_best_move(struct search_worker *worker)
+{
+    assert(valid_position(&worker->pos));
+
+    /*
+     * For multipv searches the root moves can be split between the
+     * workers. Otherwise each worker runs its own iterative deepening.
+     */
+    if (smp_parallel_multipv(worker)) {
+        search_split_root(worker);
+    } else {
+        search_iterative_deepening(worker);
+    }
 
     /*
      * In some rare cases the search may reach the maximum depth. If this
@@ -1156,11 +1359,11 @@ void search_find_best_move(struct search_worker *worker)
      */
 	while ((worker->id == 0) && worker->state->pondering) {
 		if (engine_wait_for_input(worker)) {
-			smp_stop_all();
+			smp_stop_search(worker);
             break;
 		}
 		if (!worker->state->pondering) {
-			smp_stop_all();
+			smp_stop_search(worker);
 		}
 	}
 }
@@ -19,6 +19,7 @@
 #include <string.h>
 #include <stdatomic.h>
 #include <stdlib.h>
+#include <inttypes.h>
 
 #include "smp.h"
 #include "hash.h"
@@ -33,14 +34,70 @@
 #include "bitboard.h"
 #include "board.h"
 #include "history.h"
+#include "numa.h"
+#include "cluster.h"
+#include "utils.h"
+#include "debug.h"
 
 /* Worker actions */
 #define ACTION_IDLE 0
 #define ACTION_EXIT 1
 #define ACTION_RUN 2
 
-/* Lock for updating the state struct during search */
-static mutex_t state_lock;
+/* Patterns used for assigning search depths to workers */
+#define DEPTH_PATTERN_HALF 0
+#define DEPTH_PATTERN_SKIP 1
+#define DEPTH_PATTERN_NONE 2
+
+/*
+ * Base weight of a vote when selecting the best worker. The weight is
+ * added to the score difference to the worst worker so that all
+ * workers get a say.
+ */
+#define VOTE_BASE_WEIGHT 14
+
+/* The parallel search algorithms */
+#define SMP_MODE_LAZY 0
+#define SMP_MODE_ABDADA 1
+
+/*
+ * Size of the table used by ABDADA to keep track of moves that are
+ * currently being searched. Each slot holds ABDADA_WAYS moves.
+ */
+#define ABDADA_TABLE_SIZE 32768
+#define ABDADA_WAYS 4
+
+/* The minimum depth for which moves are deferred by ABDADA */
+#define ABDADA_DEFER_DEPTH 3
+
+/*
+ * The low bits of an ABDADA table entry hold the number of workers
+ * searching the move, the remaining bits identify the move.
+ */
+#define ABDADA_COUNT_MASK 0xFFULL
+
+/* The number of entries in the depth skipping tables */
+#define SKIP_TABLE_SIZE 20
+
+/*
+ * Margin below the score of the worst multipv line of the previous
+ * iteration used as lower bound when searching root moves in parallel.
+ */
+#define ROOT_WINDOW_MARGIN 50
+
+/* Information about a move in the shared root move table */
+struct root_move {
+    /* The move */
+    uint32_t move;
+    /* The score of the move, an upper bound if exact is false */
+    int score;
+    /* Flag indicating if the score is exact */
+    bool exact;
+    /* The selective depth reached when searching the move */
+    int seldepth;
+    /* The principle variation starting with the move */
+    struct movelist pv;
+};
 
 /* Variables used to signal to workers to stop searching */
 static mutex_t stop_lock;
@@ -50,6 +107,71 @@ static atomic_bool should_stop = false;
 static int number_of_workers = 0;
 static struct search_worker *workers = NULL;
 
+/* Configuration of the pawn transposition tables */
+static int pawn_hash_size = PAWN_HASH_SIZE;
+
+/* Flag indicating if workers should be bound to their NUMA node */
+static bool numa_binding = false;
+
+/*
+ * Counter that is increased every time the thread binding settings
+ * change. Helpers compare it with the value they last applied.
+ */
+static int binding_version = 0;
+
+/* The parallel search algorithm */
+static int smp_mode = SMP_MODE_LAZY;
+
+/*
+ * Moves currently being searched by some worker when using ABDADA.
+ * Each entry is a hash of the position key and the move combined with
+ * the number of workers searching it, zero means that the entry is empty.
+ */
+static atomic_uint_least64_t abdada_table[ABDADA_TABLE_SIZE][ABDADA_WAYS];
+
+/* Flag indicating if multipv searches should split root moves */
+static bool parallel_multipv = false;
+
+/*
+ * Shared root move table used when root moves are searched in parallel.
+ * Workers claim moves from the table and report the result back. The
+ * worker finishing the last move of an iteration completes the iteration.
+ * All fields except root_depth are protected by root_lock.
+ */
+static bool root_split = false;
+static mutex_t root_lock;
+static struct root_move root_moves[MAX_MOVES];
+static int root_nmoves = 0;
+static atomic_int root_depth;
+static int root_next = 0;
+static int root_finished = 0;
+static int root_alpha = -INFINITE_SCORE;
+
+/* The pattern used for assigning search depths to workers */
+static int depth_pattern = DEPTH_PATTERN_HALF;
+
+/*
+ * The number of workers that have been assigned a depth that is
+ * greater than or equal to the index. Only used by the "half" pattern.
+ */
+static atomic_int depth_reached[MAX_SEARCH_DEPTH+2];
+
+/*
+ * Tables used by the "skip" pattern. Helpers are divided into groups
+ * where each group searches blocks of skip_size[k] depths and then skips
+ * the same number of depths. The phase spreads the helpers within a group
+ * so that all depths are covered.
+ */
+static int skip_size[SKIP_TABLE_SIZE] = {
+    1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4
+};
+static int skip_phase[SKIP_TABLE_SIZE] = {
+    0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7
+};
+
+/* The time when the current search was started (in us) */
+static uint64_t search_start_time = 0ULL;
+
 static bool probe_dtz_tables(struct gamestate *state, int *score)
 {
     unsigned int    res;
@@ -128,11 +250,52 @@ static bool probe_dtz_tables(struct gamestate *state, int *score)
     return true;
 }
 
+/*
+ * Bind the calling thread according to the current settings. Pinning to
+ * a single CPU takes precedence over binding to a NUMA node.
+ */
+static void bind_thread(int id)
+{
+    int cpu;
+
+    cpu = numa_cpu_for_worker(id);
+    if (cpu >= 0) {
+        numa_pin_thread(cpu);
+    } else if (numa_binding) {
+        numa_bind_thread(numa_node_for_worker(id));
+    } else {
+        numa_pin_thread(-1);
+    }
+}
+
+/*
+ * Helper threads are created together with the workers and are parked
+ * waiting for the start event between searches. This avoids the cost of
+ * creating new threads for every search.
+ */
 static thread_retval_t worker_thread_func(void *data)
 {
     struct search_worker *worker = data;
+    int                  version;
 
-    search_find_best_move(worker);
+    version = -1;
+    while (true) {
+        event_wait(&worker->start_event);
+        if (worker->action == ACTION_EXIT) {
+            break;
+        }
+
+        /* Follow changes to the thread binding settings */
+        if (version != binding_version) {
+            bind_thread(worker->id);
+            version = binding_version;
+        }
+
+        worker->start_latency = get_current_time_us() - search_start_time;
+        search_find_best_move(worker);
+        worker->action = ACTION_IDLE;
+        event_set(&worker->done_event);
+    }
 
     return (thread_retval_t)0;
 }
@@ -143,18 +306,23 @@ static void prepare_worker(struct search_worker *worker,
     int mpvidx;
 
     /* Copy data from game state */
-    worker->pos = state->pos;
+    board_copy(&worker->pos, &state->pos);
 
     /* Clear tables */
     killer_clear_table(worker);
     counter_clear_table(worker);
 
     /* Clear statistics */
-    worker->nodes = 0;
-    worker->qnodes = 0;
-    worker->currmovenumber = 0;
-    worker->currmove = NOMOVE;
-    worker->tbhits = 0ULL;
+    atomic_store_explicit(&worker->stats.nodes, 0, memory_order_relaxed);
+    atomic_store_explicit(&worker->stats.qnodes, 0, memory_order_relaxed);
+    atomic_store_explicit(&worker->stats.tbhits, 0, memory_order_relaxed);
+    worker->stats.currmovenumber = 0;
+    worker->stats.currmove = NOMOVE;
+    worker->pawntt_probes = 0ULL;
+    worker->pawntt_hits = 0ULL;
+#ifdef SEARCH_STATS
+    memset(worker->search_stats, 0, sizeof(worker->search_stats));
+#endif
 
     /* Clear best move information */
     for (mpvidx=0;mpvidx<state->multipv;mpvidx++) {
@@ -181,16 +349,289 @@ static void prepare_worker(struct search_worker *worker,
     worker->action = ACTION_IDLE;
 }
 
+static bool skip_depth(struct search_worker *worker, int depth)
+{
+    int count;
+    int idx;
+
+    /* With ABDADA all workers search the same depth */
+    if ((number_of_workers == 1) || (smp_mode == SMP_MODE_ABDADA)) {
+        return false;
+    }
+
+    switch (depth_pattern) {
+    case DEPTH_PATTERN_HALF:
+        /* Skip depths that are already searched by half of the workers */
+        count = atomic_load_explicit(&depth_reached[depth],
+                                     memory_order_relaxed);
+        return ((count+1)/2) >= (number_of_workers/2);
+    case DEPTH_PATTERN_SKIP:
+        /* The master worker searches all depths */
+        if (worker->id == 0) {
+            return false;
+        }
+        idx = (worker->id-1)%SKIP_TABLE_SIZE;
+        return ((depth+skip_phase[idx])/skip_size[idx])%2 != 0;
+    case DEPTH_PATTERN_NONE:
+    default:
+        return false;
+    }
+}
+
+static int next_depth(struct search_worker *worker, int depth)
+{
+    int new_depth;
+    int k;
+
+    new_depth = depth + 1;
+    while ((new_depth <= MAX_SEARCH_DEPTH) && skip_depth(worker, new_depth)) {
+        new_depth++;
+    }
+
+    /*
+     * Helpers do not search depths that have already been completed
+     * by another process in the cluster.
+     */
+    if (worker->id != 0) {
+        new_depth = MAX(new_depth, cluster_completed_depth()+1);
+    }
+
+    /*
+     * Register the new depth. Two workers that select a depth at the
+     * same time may both pick it, which only affects thread diversity.
+     */
+    if (depth_pattern == DEPTH_PATTERN_HALF) {
+        for (k=depth+1;k<=new_depth;k++) {
+            atomic_fetch_add_explicit(&depth_reached[k], 1,
+                                      memory_order_relaxed);
+        }
+    }
+
+    return new_depth;
+}
+
+static struct search_worker* select_best_worker(int64_t *votes,
+                                                int64_t *total, char **reason)
+{
+    struct search_worker *best;
+    struct search_worker *worker;
+    int64_t              move_votes[MAX_WORKERS];
+    int                  min_score;
+    int                  k;
+    int                  l;
+
+    best = &workers[0];
+    *votes = 0;
+    *total = 0;
+    *reason = "master";
+
+    /* Find the lowest score among workers with a move */
+    min_score = INFINITE_SCORE;
+    for (k=0;k<number_of_workers;k++) {
+        worker = &workers[k];
+        if (worker->mpv_moves[0] != NOMOVE) {
+            min_score = MIN(min_score, worker->mpv_lines[0].score);
+        }
+    }
+    if (min_score == INFINITE_SCORE) {
+        return best;
+    }
+
+    /*
+     * Each worker votes for its best move. The weight of the vote
+     * depends on the depth and on how much better the score is compared
+     * to the other workers.
+     */
+    for (k=0;k<number_of_workers;k++) {
+        move_votes[k] = 0;
+    }
+    for (k=0;k<number_of_workers;k++) {
+        worker = &workers[k];
+        if (worker->mpv_moves[0] == NOMOVE) {
+            continue;
+        }
+        for (l=0;l<number_of_workers;l++) {
+            if (workers[l].mpv_moves[0] == worker->mpv_moves[0]) {
+                move_votes[l] += (int64_t)(worker->mpv_lines[0].score -
+                                           min_score + VOTE_BASE_WEIGHT)*
+                                 worker->mpv_lines[0].depth;
+            }
+        }
+        *total += (int64_t)(worker->mpv_lines[0].score - min_score +
+                            VOTE_BASE_WEIGHT)*worker->mpv_lines[0].depth;
+    }
+
+    /*
+     * Select the move with the most votes. A found mate overrides
+     * the vote and among the workers that agree on the move the one
+     * with the deepest search is used since it has the best pv.
+     */
+    for (k=0;k<number_of_workers;k++) {
+        worker = &workers[k];
+        if (worker->mpv_moves[0] == NOMOVE) {
+            continue;
+        }
+        if (best->mpv_moves[0] == NOMOVE) {
+            best = worker;
+            *reason = "votes";
+        } else if (worker->mpv_lines[0].score > KNOWN_WIN) {
+            if (worker->mpv_lines[0].score > best->mpv_lines[0].score) {
+                best = worker;
+                *reason = "mate";
+            }
+        } else if (best->mpv_lines[0].score > KNOWN_WIN) {
+            continue;
+        } else if (move_votes[k] > move_votes[best->id]) {
+            best = worker;
+            *reason = "votes";
+        } else if ((worker->mpv_moves[0] == best->mpv_moves[0]) &&
+                   (worker->mpv_lines[0].depth > best->mpv_lines[0].depth)) {
+            best = worker;
+            *reason = (best->mpv_moves[0] == workers[0].mpv_moves[0])?
+                                                            "depth":"votes";
+        }
+    }
+    *votes = move_votes[best->id];
+
+    return best;
+}
+
+static uint64_t abdada_hash(uint64_t key, uint32_t move)
+{
+    uint64_t hash;
+
+    hash = (key^((uint64_t)move*0x9E3779B97F4A7C15ULL))&~ABDADA_COUNT_MASK;
+    return (hash != 0ULL)?hash:(ABDADA_COUNT_MASK+1);
+}
+
+static void abdada_clear_table(void)
+{
+    int k;
+    int l;
+
+    for (k=0;k<ABDADA_TABLE_SIZE;k++) {
+        for (l=0;l<ABDADA_WAYS;l++) {
+            atomic_store_explicit(&abdada_table[k][l], 0ULL,
+                                  memory_order_relaxed);
+        }
+    }
+}
+
+static void init_root_table(struct gamestate *state, struct movelist *legal)
+{
+    struct movelist *moves;
+    int             k;
+
+    moves = (state->move_filter.size > 0)?&state->move_filter:legal;
+    for (k=0;k<moves->size;k++) {
+        root_moves[k].move = moves->moves[k];
+        root_moves[k].score = -INFINITE_SCORE;
+        root_moves[k].exact = false;
+        root_moves[k].seldepth = 0;
+        root_moves[k].pv.size = 0;
+    }
+    root_nmoves = moves->size;
+    root_next = 0;
+    root_finished = 0;
+    root_alpha = -INFINITE_SCORE;
+    atomic_store(&root_depth, 1);
+}
+
+static void sort_root_moves(void)
+{
+    struct root_move tmp;
+    int              k;
+    int              l;
+
+    /* Insertion sort to keep the order of moves with equal scores */
+    for (k=1;k<root_nmoves;k++) {
+        tmp = root_moves[k];
+        for (l=k;(l > 0) && (root_moves[l-1].score < tmp.score);l--) {
+            root_moves[l] = root_moves[l-1];
+        }
+        root_moves[l] = tmp;
+    }
+}
+
+static void complete_root_phase(struct gamestate *state)
+{
+    struct search_worker *master = &workers[0];
+    int                  depth;
+    int                  nexact;
+    int                  score;
+    int                  k;
+
+    depth = atomic_load(&root_depth);
+    nexact = 0;
+    for (k=0;k<root_nmoves;k++) {
+        if (root_moves[k].exact) {
+            nexact++;
+        }
+    }
+
+    /*
+     * If too few moves scored above the lower bound then the moves
+     * that failed low are searched again with an infinite window.
+     */
+    if ((nexact < state->multipv) && (root_alpha > -INFINITE_SCORE)) {
+        root_alpha = -INFINITE_SCORE;
+        root_next = 0;
+        root_finished = nexact;
+        return;
+    }
+
+    /* Publish the best lines as the result of the master worker */
+    sort_root_moves();
+    for (k=0;k<state->multipv;k++) {
+        master->mpv_moves[k] = root_moves[k].move;
+        master->mpv_lines[k].pv = root_moves[k].pv;
+        master->mpv_lines[k].score = root_moves[k].score;
+        master->mpv_lines[k].depth = depth;
+        master->mpv_lines[k].seldepth = root_moves[k].seldepth;
+    }
+    atomic_store(&state->completed_depth, depth);
+    engine_send_multipv_info(master);
+
+    /*
+     * Check if the maximum depth has been reached or if the score
+     * indicates a known win.
+     */
+    score = root_moves[0].score;
+    if ((depth >= state->sd) ||
+        (state->exit_on_mate && !state->pondering &&
+         ((score > KNOWN_WIN) || (score < (-KNOWN_WIN))))) {
+        smp_stop_all();
+    }
+
+    /*
+     * Setup the next iteration. Moves are searched in the order of
+     * the previous iteration using a lower bound slightly below the
+     * score of the worst line.
+     */
+    score = root_moves[state->multipv-1].score;
+    if ((score > KNOWN_WIN) || (score < (-KNOWN_WIN))) {
+        root_alpha = -INFINITE_SCORE;
+    } else {
+        root_alpha = score - ROOT_WINDOW_MARGIN;
+    }
+    for (k=0;k<root_nmoves;k++) {
+        root_moves[k].exact = false;
+    }
+    root_next = 0;
+    root_finished = 0;
+    atomic_store(&root_depth, depth+1);
+}
+
 void smp_init(void)
 {
-    mutex_init(&state_lock);
     mutex_init(&stop_lock);
+    mutex_init(&root_lock);
 }
 
 void smp_destroy(void)
 {
-    mutex_destroy(&state_lock);
     mutex_destroy(&stop_lock);
+    mutex_destroy(&root_lock);
 }
 
 void smp_create_workers(int nthreads)
@@ -198,12 +639,28 @@ void smp_create_workers(int nthreads)
     int k;
 
     number_of_workers = nthreads;
-    workers = malloc(number_of_workers*sizeof(struct search_worker));
+    workers = aligned_malloc(CACHE_LINE_SIZE,
+                             number_of_workers*sizeof(struct search_worker));
     for (k=0;k<number_of_workers;k++) {
+        /*
+         * Place the worker on the NUMA node where it will run
+         * before the memory is touched for the first time.
+         */
+        numa_place_memory(&workers[k], sizeof(struct search_worker),
+                          numa_node_for_worker(k));
         memset(&workers[k], 0, sizeof(struct search_worker));
-        hash_pawntt_create_table(&workers[k], PAWN_HASH_SIZE);
         workers[k].state = NULL;
         workers[k].id = k;
+        workers[k].action = ACTION_IDLE;
+        hash_pawntt_create_table(&workers[k], pawn_hash_size);
+    }
+
+    /* Start parked helper threads, the master runs in the calling thread */
+    for (k=1;k<number_of_workers;k++) {
+        event_init(&workers[k].start_event);
+        event_init(&workers[k].done_event);
+        thread_create(&workers[k].thread, (thread_func_t)worker_thread_func,
+                      &workers[k]);
     }
 }
 
@@ -211,14 +668,61 @@ void smp_destroy_workers(void)
 {
     int k;
 
+    /* Wake all helper threads and tell them to exit */
+    for (k=1;k<number_of_workers;k++) {
+        workers[k].action = ACTION_EXIT;
+        event_set(&workers[k].start_event);
+        thread_join(&workers[k].thread);
+        event_destroy(&workers[k].start_event);
+        event_destroy(&workers[k].done_event);
+    }
+
     for (k=0;k<number_of_workers;k++) {
         hash_pawntt_destroy_table(&workers[k]);
     }
-    free(workers);
+    aligned_free(workers);
     workers = NULL;
     number_of_workers = 0;
 }
 
+void smp_set_pawn_hash(int size, bool shared)
+{
+    int k;
+
+    pawn_hash_size = size;
+    hash_pawntt_set_shared(shared);
+
+    /* Re-create the tables of all existing workers */
+    for (k=0;k<number_of_workers;k++) {
+        hash_pawntt_destroy_table(&workers[k]);
+    }
+    for (k=0;k<number_of_workers;k++) {
+        hash_pawntt_create_table(&workers[k], pawn_hash_size);
+    }
+}
+
+void smp_set_numa_binding(bool enable)
+{
+    numa_binding = enable;
+    binding_version++;
+
+    /* The master worker runs in the calling thread */
+    bind_thread(0);
+}
+
+bool smp_set_cpu_affinity(char *spec, bool avoid_smt)
+{
+    if (!numa_set_cpu_affinity(spec, avoid_smt)) {
+        return false;
+    }
+    binding_version++;
+
+    /* The master worker runs in the calling thread */
+    bind_thread(0);
+
+    return true;
+}
+
 int smp_number_of_workers(void)
 {
     return number_of_workers;
@@ -237,14 +741,18 @@ void smp_search(struct gamestate *state, bool pondering, bool use_book,
                 bool use_tablebases)
 {
     int                  k;
-    struct search_worker *worker;
     struct search_worker *best;
     struct movelist      legal;
+    int64_t              votes;
+    int64_t              total_votes;
+    char                 *reason;
 
     assert(valid_position(&state->pos));
     assert(number_of_workers > 0);
     assert(workers != NULL);
 
+    search_start_time = get_current_time_us();
+
     /* Reset the best move information */
     state->best_move = NOMOVE;
     state->ponder_move = NOMOVE;
@@ -274,6 +782,9 @@ void smp_search(struct gamestate *state, bool pondering, bool use_book,
     state->pondering = pondering;
     state->pos.sply = 0;
     state->completed_depth = 0;
+    for (k=0;k<=MAX_SEARCH_DEPTH+1;k++) {
+        atomic_store_explicit(&depth_reached[k], 0, memory_order_relaxed);
+    }
 
     /* Probe tablebases for the root position */
     if (use_tablebases &&
@@ -316,37 +827,59 @@ void smp_search(struct gamestate *state, bool pondering, bool use_book,
         return;
     }
 
+    /*
+     * Entries for moves that were being searched when the previous
+     * search was aborted are never removed so start from an empty table.
+     */
+    if ((smp_mode == SMP_MODE_ABDADA) && (number_of_workers > 1)) {
+        abdada_clear_table();
+    }
+
+    /* Setup the shared root move table if root moves are split */
+    root_split = parallel_multipv && (state->multipv > 1) &&
+                 (number_of_workers > 1);
+    if (root_split) {
+        init_root_table(state, &legal);
+    }
+
     /* Prepare workers for a new search */
     for (k=0;k<number_of_workers;k++) {
         prepare_worker(&workers[k], state);
     }
 
-    /* Start helpers */
+    /* Wake up the parked helpers */
     should_stop = false;
     for (k=1;k<number_of_workers;k++) {
-        thread_create(&workers[k].thread, (thread_func_t)worker_thread_func,
-                      &workers[k]);
+        workers[k].action = ACTION_RUN;
+        event_set(&workers[k].start_event);
+    }
+
+    /* Start the search in the other processes of the cluster */
+    if (cluster_number_of_nodes() > 1) {
+        cluster_start_search(state);
     }
 
     /* Start the master worker thread */
+    workers[0].start_latency = get_current_time_us() - search_start_time;
     search_find_best_move(&workers[0]);
 
     /* Wait for all helpers to finish */
     for (k=1;k<number_of_workers;k++) {
-        thread_join(&workers[k].thread);
+        event_wait(&workers[k].done_event);
     }
+    if (cluster_number_of_nodes() > 1) {
+        cluster_stop_search();
+    }
+    LOG_INFO1("Search start latency: %"PRIu64" us\n", smp_start_latency());
+#ifdef SEARCH_STATS
+    engine_send_search_stats(&workers[0]);
+#endif
 
     /* Find the worker with the best move */
     best = &workers[0];
-    if (state->multipv == 1) {
-        for (k=1;k<number_of_workers;k++) {
-            worker = &workers[k];
-            if ((worker->mpv_lines[0].depth > best->mpv_lines[0].depth) ||
-                ((worker->mpv_lines[0].depth == best->mpv_lines[0].depth) &&
-                (worker->mpv_lines[0].score > best->mpv_lines[0].score))) {
-                best = worker;
-            }
-        }
+    if ((state->multipv == 1) && (number_of_workers > 1)) {
+        best = select_best_worker(&votes, &total_votes, &reason);
+        engine_send_selection_info(best, votes, total_votes, reason);
     }
 
     /*
@@ -375,9 +908,9 @@ uint64_t smp_nodes(void)
 
     nodes = 0ULL;
     for (k=0;k<number_of_workers;k++) {
-        nodes += workers[k].nodes;
+        nodes += STATS_GET(workers[k].stats.nodes);
     }
-    return nodes;
+    return nodes + cluster_nodes();
 }
 
 uint64_t smp_tbhits(void)
@@ -387,11 +920,128 @@ uint64_t smp_tbhits(void)
 
     tbhits = 0ULL;
     for (k=0;k<number_of_workers;k++) {
-        tbhits += workers[k].tbhits;
+        tbhits += STATS_GET(workers[k].stats.tbhits);
     }
     return tbhits;
 }
 
+void smp_pawntt_statistics(uint64_t *probes, uint64_t *hits)
+{
+    int k;
+
+    *probes = 0ULL;
+    *hits = 0ULL;
+    for (k=0;k<number_of_workers;k++) {
+        *probes += workers[k].pawntt_probes;
+        *hits += workers[k].pawntt_hits;
+    }
+}
+
+bool smp_search_statistics(uint64_t stats[MAX_SEARCH_DEPTH][NSEARCHSTATS])
+{
+    memset(stats, 0, sizeof(uint64_t)*MAX_SEARCH_DEPTH*NSEARCHSTATS);
+#ifdef SEARCH_STATS
+    int k;
+    int depth;
+    int stat;
+
+    for (k=0;k<number_of_workers;k++) {
+        for (depth=0;depth<MAX_SEARCH_DEPTH;depth++) {
+            for (stat=0;stat<NSEARCHSTATS;stat++) {
+                stats[depth][stat] += workers[k].search_stats[depth][stat];
+            }
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t smp_start_latency(void)
+{
+    uint64_t latency;
+    int      k;
+
+    latency = 0ULL;
+    for (k=0;k<number_of_workers;k++) {
+        latency = MAX(latency, workers[k].start_latency);
+    }
+    return latency;
+}
+
+struct search_worker* smp_create_isolated_worker(void)
+{
+    struct search_worker *worker;
+
+    worker = aligned_malloc(CACHE_LINE_SIZE, sizeof(struct search_worker));
+    if (worker == NULL) {
+        return NULL;
+    }
+    memset(worker, 0, sizeof(struct search_worker));
+    worker->state = NULL;
+    worker->id = 0;
+    worker->action = ACTION_IDLE;
+    worker->isolated = true;
+    hash_pawntt_create_table(worker, pawn_hash_size);
+
+    return worker;
+}
+
+void smp_destroy_isolated_worker(struct search_worker *worker)
+{
+    assert(worker != NULL);
+    assert(worker->isolated);
+
+    hash_pawntt_destroy_table(worker);
+    aligned_free(worker);
+}
+
+void smp_search_isolated(struct search_worker *worker,
+                         struct gamestate *state)
+{
+    struct movelist legal;
+
+    assert(worker != NULL);
+    assert(worker->isolated);
+    assert(valid_position(&state->pos));
+
+    /* Prepare for search */
+    state->best_move = NOMOVE;
+    state->ponder_move = NOMOVE;
+    state->probe_wdl = TB_LARGEST > 0;
+    state->root_in_tb = false;
+    state->root_tb_score = 0;
+    state->pondering = false;
+    state->pos.sply = 0;
+    state->multipv = 1;
+    state->move_filter.size = 0;
+    state->completed_depth = 0;
+    prepare_worker(worker, state);
+
+    /*
+     * Initialize the best move to the first legal root
+     * move to make sure a legal move is always returned.
+     */
+    gen_legal_moves(&state->pos, &legal);
+    if (legal.size == 0) {
+        return;
+    }
+    state->best_move = legal.moves[0];
+
+    /* Search */
+    history_clear_tables(worker);
+    atomic_store(&worker->stop, false);
+    search_find_best_move(worker);
+
+    /* Copy the best move to the state struct */
+    if (worker->mpv_moves[0] != NOMOVE) {
+        state->best_move = worker->mpv_moves[0];
+        state->ponder_move = (worker->mpv_lines[0].pv.size > 1)?
+                                    worker->mpv_lines[0].pv.moves[1]:NOMOVE;
+    }
+}
+
 void smp_stop_all(void)
 {
     mutex_lock(&stop_lock);
@@ -399,46 +1049,238 @@ void smp_stop_all(void)
     mutex_unlock(&stop_lock);
 }
 
-bool smp_should_stop(void)
+void smp_stop_search(struct search_worker *worker)
+{
+    if (worker->isolated) {
+        atomic_store(&worker->stop, true);
+    } else {
+        smp_stop_all();
+    }
+}
+
+bool smp_should_stop(struct search_worker *worker)
 {
+    if (worker->isolated) {
+        return atomic_load_explicit(&worker->stop, memory_order_relaxed);
+    }
     return atomic_load_explicit(&should_stop, memory_order_relaxed);
 }
 
-int smp_complete_iteration(struct search_worker *worker)
+int smp_first_depth(struct search_worker *worker)
 {
-    int new_depth;
-    int count;
-    int k;
+    if (worker->isolated) {
+        return 1;
+    }
+    return next_depth(worker, 0);
+}
 
-    mutex_lock(&state_lock);
+int smp_complete_iteration(struct search_worker *worker)
+{
+    int completed;
 
     /*
      * If this is the first time completing this depth then
      * update the completed_depth counter.
      */
-    if (worker->depth > worker->state->completed_depth) {
-        worker->state->completed_depth = worker->depth;
+    completed = atomic_load(&worker->state->completed_depth);
+    while ((worker->depth > completed) &&
+           !atomic_compare_exchange_weak(&worker->state->completed_depth,
+                                         &completed, worker->depth)) {
+        /* Retry with the updated value */
     }
 
     /* Calculate the next depth for this worker to search */
-    new_depth = worker->depth;
-    while (true) {
-        new_depth++;
-        count = 0;
-        for (k=0;k<number_of_workers;k++) {
-            if (workers[k].depth >= new_depth) {
-                count++;
-            }
-            if (((count+1)/2) >= (number_of_workers/2)) {
-                break;
+    if (worker->isolated) {
+        return worker->depth + 1;
+    }
+    return next_depth(worker, worker->depth);
+}
+
+bool smp_set_depth_pattern(char *pattern)
+{
+    if (!strncmp(pattern, "half", 4)) {
+        depth_pattern = DEPTH_PATTERN_HALF;
+    } else if (!strncmp(pattern, "skip", 4)) {
+        depth_pattern = DEPTH_PATTERN_SKIP;
+    } else if (!strncmp(pattern, "none", 4)) {
+        depth_pattern = DEPTH_PATTERN_NONE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool smp_set_mode(char *mode)
+{
+    if (!strncmp(mode, "lazy", 4)) {
+        smp_mode = SMP_MODE_LAZY;
+    } else if (!strncmp(mode, "abdada", 6)) {
+        smp_mode = SMP_MODE_ABDADA;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void smp_set_parallel_multipv(bool enable)
+{
+    parallel_multipv = enable;
+}
+
+bool smp_parallel_multipv(struct search_worker *worker)
+{
+    return root_split && !worker->isolated;
+}
+
+int smp_root_depth(void)
+{
+    return atomic_load(&root_depth);
+}
+
+int smp_root_get_move(int depth, uint32_t *move, int *alpha)
+{
+    int idx = -1;
+
+    assert(move != NULL);
+    assert(alpha != NULL);
+
+    mutex_lock(&root_lock);
+    while ((root_next < root_nmoves) && root_moves[root_next].exact) {
+        root_next++;
+    }
+    if ((atomic_load(&root_depth) == depth) && (root_next < root_nmoves)) {
+        idx = root_next++;
+        *move = root_moves[idx].move;
+        *alpha = root_alpha;
+    }
+    mutex_unlock(&root_lock);
+
+    return idx;
+}
+
+void smp_root_put_result(struct search_worker *worker, int idx, int alpha,
+                         int score)
+{
+    struct root_move *rm;
+
+    assert((idx >= 0) && (idx < root_nmoves));
+
+    mutex_lock(&root_lock);
+    rm = &root_moves[idx];
+    rm->score = score;
+    rm->exact = score > alpha;
+    rm->seldepth = worker->stats.seldepth;
+    if (rm->exact) {
+        rm->pv = worker->pv_table[0];
+    } else {
+        rm->pv.moves[0] = rm->move;
+        rm->pv.size = 1;
+    }
+    root_finished++;
+    if (root_finished == root_nmoves) {
+        complete_root_phase(worker->state);
+    }
+    mutex_unlock(&root_lock);
+}
+
+bool smp_abdada_enabled(struct search_worker *worker)
+{
+    return (smp_mode == SMP_MODE_ABDADA) && (number_of_workers > 1) &&
+           !worker->isolated;
+}
+
+bool smp_abdada_defer_move(uint64_t key, uint32_t move, int depth)
+{
+    uint64_t hash;
+    uint64_t entry;
+    int      idx;
+    int      k;
+
+    if (depth < ABDADA_DEFER_DEPTH) {
+        return false;
+    }
+
+    hash = abdada_hash(key, move);
+    idx = (int)((hash>>8)&(ABDADA_TABLE_SIZE-1));
+    for (k=0;k<ABDADA_WAYS;k++) {
+        entry = atomic_load_explicit(&abdada_table[idx][k],
+                                     memory_order_relaxed);
+        if ((entry&~ABDADA_COUNT_MASK) == hash) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void smp_abdada_start_move(uint64_t key, uint32_t move, int depth)
+{
+    uint64_t hash;
+    uint64_t entry;
+    uint64_t count;
+    int      idx;
+    int      k;
+
+    if (depth < ABDADA_DEFER_DEPTH) {
+        return;
+    }
+
+    /*
+     * Increase the number of searchers if the move is already in
+     * the table, otherwise use an empty way if there is one. If all
+     * ways are taken then the first way is replaced. The table is only
+     * a hint so lost updates are harmless.
+     */
+    hash = abdada_hash(key, move);
+    idx = (int)((hash>>8)&(ABDADA_TABLE_SIZE-1));
+    for (k=0;k<ABDADA_WAYS;k++) {
+        entry = atomic_load_explicit(&abdada_table[idx][k],
+                                     memory_order_relaxed);
+        while ((entry&~ABDADA_COUNT_MASK) == hash) {
+            count = entry&ABDADA_COUNT_MASK;
+            if ((count == ABDADA_COUNT_MASK) ||
+                atomic_compare_exchange_weak(&abdada_table[idx][k], &entry,
+                                             entry+1)) {
+                return;
             }
         }
-        if (k == number_of_workers || (number_of_workers == 1)) {
-            break;
+        if ((entry == 0ULL) &&
+            atomic_compare_exchange_strong(&abdada_table[idx][k], &entry,
+                                           hash|1ULL)) {
+            return;
         }
     }
+    atomic_store_explicit(&abdada_table[idx][0], hash|1ULL,
+                          memory_order_relaxed);
+}
 
-    mutex_unlock(&state_lock);
+void smp_abdada_finish_move(uint64_t key, uint32_t move, int depth)
+{
+    uint64_t hash;
+    uint64_t entry;
+    uint64_t count;
+    int      idx;
+    int      k;
 
-    return new_depth;
+    if (depth < ABDADA_DEFER_DEPTH) {
+        return;
+    }
+
+    /*
+     * Only clear the entry when the last worker searching the
+     * move is done. If the entry has been replaced then there
+     * is nothing to do.
+     */
+    hash = abdada_hash(key, move);
+    idx = (int)((hash>>8)&(ABDADA_TABLE_SIZE-1));
+    for (k=0;k<ABDADA_WAYS;k++) {
+        entry = atomic_load_explicit(&abdada_table[idx][k],
+                                     memory_order_relaxed);
+        while ((entry&~ABDADA_COUNT_MASK) == hash) {
+            count = entry&ABDADA_COUNT_MASK;
+            if (atomic_compare_exchange_weak(&abdada_table[idx][k], &entry,
+                                             (count > 1)?entry-1:0ULL)) {
+                return;
+            }
+        }
+    }
 }
@@ -27,7 +27,8 @@ void smp_init(void);
 void smp_destroy(void);
 
 /*
- * Create worker threads.
+ * Create workers. Helper threads are started and parked
+ * waiting for searches.
  *
  * @param nthreads The number of threads to create.
  */
@@ -36,6 +37,35 @@ void smp_create_workers(int nthreads);
 /* Destroy all workers */
 void smp_destroy_workers(void);
 
+/*
+ * Configure the pawn transposition tables. The tables of
+ * existing workers are re-created.
+ *
+ * @param size The size of the pawn transposition table (in MB).
+ * @param shared If a single table should be shared by all workers.
+ */
+void smp_set_pawn_hash(int size, bool shared);
+
+/*
+ * Enable or disable binding of workers to the NUMA node where
+ * their memory is located.
+ *
+ * @param enable If workers should be bound to their NUMA node.
+ */
+void smp_set_numa_binding(bool enable);
+
+/*
+ * Configure pinning of workers to individual CPUs. Pinning takes
+ * precedence over NUMA node binding. See numa_set_cpu_affinity for
+ * a description of the parameters.
+ *
+ * @param spec The pinning specification.
+ * @param avoid_smt If the second hardware thread of a core should only be
+ *                  used after all cores have a worker.
+ * @return Returns false if the specification is invalid.
+ */
+bool smp_set_cpu_affinity(char *spec, bool avoid_smt);
+
 /*
  * Get the number of workers being used.
  *
@@ -71,17 +101,100 @@ uint64_t smp_nodes(void);
  */
 uint64_t smp_tbhits(void);
 
+/*
+ * Statistics for the pawn transposition tables during search.
+ *
+ * @param probes Location to store the total number of lookups at.
+ * @param hits Location to store the total number of hits at.
+ */
+void smp_pawntt_statistics(uint64_t *probes, uint64_t *hits);
+
+/*
+ * Search statistics from the latest search, summed over all workers.
+ *
+ * @param stats Location to store the counters at, indexed by remaining
+ *              depth and counter.
+ * @return Returns false if the engine was built without support
+ *         for search statistics.
+ */
+bool smp_search_statistics(uint64_t stats[MAX_SEARCH_DEPTH][NSEARCHSTATS]);
+
+/*
+ * The time it took for all workers to start searching in the latest
+ * search, measured from the start of the search.
+ *
+ * @return Returns the latency of the slowest worker (in microseconds).
+ */
+uint64_t smp_start_latency(void);
+
 /*
  * Stop all workers.
  */
 void smp_stop_all(void);
 
+/*
+ * Stop the search that a worker is part of. For an isolated worker only
+ * that worker is stopped, otherwise all workers are stopped.
+ *
+ * @param worker The worker.
+ */
+void smp_stop_search(struct search_worker *worker);
+
 /*
  * Check if searching should stop.
  *
+ * @param worker The worker.
  * @return Returns true if searching should stop.
  */
-bool smp_should_stop(void);
+bool smp_should_stop(struct search_worker *worker);
+
+/*
+ * Create a worker for running isolated searches. Isolated searches are
+ * single-threaded and do not use or affect the state of the regular
+ * workers, except for the shared transposition table. Several isolated
+ * searches can run at the same time in different threads.
+ *
+ * @return Returns the new worker, or NULL on failure.
+ */
+struct search_worker* smp_create_isolated_worker(void);
+
+/*
+ * Destroy a worker created by smp_create_isolated_worker.
+ *
+ * @param worker The worker.
+ */
+void smp_destroy_isolated_worker(struct search_worker *worker);
+
+/*
+ * Run an isolated search in the calling thread. The opening book and
+ * the root tablebase probe are not used and no output is produced
+ * unless the state says so. The result is stored in the state.
+ *
+ * @param worker The isolated worker to use.
+ * @param state The game state.
+ */
+void smp_search_isolated(struct search_worker *worker,
+                         struct gamestate *state);
+
+/*
+ * Select the pattern used for assigning search depths to helper workers.
+ * The supported patterns are "half" (a depth is skipped when half of the
+ * workers are already searching it), "skip" (helpers skip blocks of
+ * depths based on their id) and "none" (all workers search all depths).
+ *
+ * @param pattern The name of the pattern.
+ * @return Returns false if the pattern is unknown.
+ */
+bool smp_set_depth_pattern(char *pattern);
+
+/*
+ * Called by workers before starting their first search iteration.
+ *
+ * @param worker The worker.
+ * @return Returns the depth the worker should search to for the
+ *         first iteration.
+ */
+int smp_first_depth(struct search_worker *worker);
 
 /*
  * Called by workers when they have finished a search iteration.
@@ -92,4 +205,101 @@ bool smp_should_stop(void);
  */
 int smp_complete_iteration(struct search_worker *worker);
 
+/*
+ * Select the parallel search algorithm. The supported algorithms are
+ * "lazy" (Lazy SMP) and "abdada" (ABDADA, where workers defer moves
+ * that are already being searched by another worker).
+ *
+ * @param mode The name of the algorithm.
+ * @return Returns false if the algorithm is unknown.
+ */
+bool smp_set_mode(char *mode);
+
+/*
+ * Enable or disable splitting of root moves between workers for
+ * multipv searches. When enabled the root moves are distributed
+ * to the workers through a shared table instead of each worker
+ * searching all lines.
+ *
+ * @param enable If root moves should be split.
+ */
+void smp_set_parallel_multipv(bool enable);
+
+/*
+ * Check if root moves are split between workers for the current search.
+ *
+ * @param worker The worker.
+ * @return Returns true if root moves are split.
+ */
+bool smp_parallel_multipv(struct search_worker *worker);
+
+/*
+ * Get the depth of the iteration currently being searched when root
+ * moves are split between workers.
+ *
+ * @return Returns the depth.
+ */
+int smp_root_depth(void);
+
+/*
+ * Claim a root move to search.
+ *
+ * @param depth The depth of the iteration the worker is searching.
+ * @param move Location to store the move at.
+ * @param alpha Location to store the lower bound to use at.
+ * @return Returns the index of the move, or -1 if all moves for the
+ *         iteration have been claimed.
+ */
+int smp_root_get_move(int depth, uint32_t *move, int *alpha);
+
+/*
+ * Report the result of searching a root move. The principle variation
+ * is taken from the worker. If this was the last move of the iteration
+ * then the iteration is completed and the result is sent to the GUI.
+ *
+ * @param worker The worker.
+ * @param idx The index of the move as returned by smp_root_get_move.
+ * @param alpha The lower bound used for the search.
+ * @param score The score of the move.
+ */
+void smp_root_put_result(struct search_worker *worker, int idx, int alpha,
+                         int score);
+
+/*
+ * Check if ABDADA is used for the current search.
+ *
+ * @param worker The worker.
+ * @return Returns true if ABDADA is used.
+ */
+bool smp_abdada_enabled(struct search_worker *worker);
+
+/*
+ * Check if a move should be deferred because another worker
+ * is currently searching it.
+ *
+ * @param key The key of the position where the move is played.
+ * @param move The move.
+ * @param depth The remaining depth of the node.
+ * @return Returns true if the move should be deferred.
+ */
+bool smp_abdada_defer_move(uint64_t key, uint32_t move, int depth);
+
+/*
+ * Mark a move as being searched.
+ *
+ * @param key The key of the position where the move is played.
+ * @param move The move.
+ * @param depth The remaining depth of the node.
+ */
+void smp_abdada_start_move(uint64_t key, uint32_t move, int depth);
+
+/*
+ * Mark a move as no longer being searched.
+ *
+ * @param key The key of the position where the move is played.
+ * @param move The move.
+ * @param depth The remaining depth of the node.
+ */
+void smp_abdada_finish_move(uint64_t key, uint32_t move, int depth);
+
 #endif
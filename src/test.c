@@ -17,6 +17,7 @@
  */
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <inttypes.h>
 
 #include "test.h"
@@ -33,10 +34,43 @@
 #include "engine.h"
 #include "timectl.h"
 #include "smp.h"
+#include "thread.h"
 
 /* Depth to search the benchmark positions to */
 #define BENCH_DEPTH 15
 
+/* Number of searches and search depth used by the start latency test */
+#define LATENCY_NSEARCHES 200
+#define LATENCY_DEPTH 1
+
+/* The time to search each position when measuring NPS scaling (in ms) */
+#define SCALING_TIME 1000
+
+/* The number of positions to search when measuring NPS scaling */
+#define SCALING_NPOSITIONS 4
+
+/* Depth to search to when measuring time to depth */
+#define TTD_DEPTH 13
+
+/* Number of iterations for each thread in the transposition table test */
+#define TT_STRESS_ITERATIONS 5000000
+
+/* Number of different keys used by the transposition table test */
+#define TT_STRESS_NKEYS 256
+
+/* Number of buckets that the transposition table test is limited to */
+#define TT_STRESS_NBUCKETS 16
+
+/* Data for a thread in the transposition table test */
+struct tt_stress_data {
+    thread_t        thread;
+    struct position pos;
+    uint64_t        seed;
+    uint64_t        nlookups;
+    uint64_t        nhits;
+    uint64_t        nerrors;
+};
+
 /* Benchmark positions */
 static char *positions[] = {
     "r4rk1/pp3ppp/2npb3/2p5/P1B1Pb1q/2PPN3/1P3R1P/R1BQ2K1 w - - 0 1",
@@ -73,6 +107,27 @@ static char *positions[] = {
     "2K5/r6k/7p/4N3/5P2/8/8/8 b - - 0 1"
 };
 
+/* Position with a known perft result */
+struct perft_position {
+    char     *fen;
+    int      depth;
+    uint32_t nleafs;
+};
+
+/* Positions used for comparing the move generators */
+static struct perft_position perft_positions[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6, 119060324},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5,
+     193690690},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5,
+     15833292},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5,
+     89941194},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+     5, 164075551}
+};
+
 static void perft(struct position *pos, int depth, uint32_t *nleafs)
 {
     struct movelist list;
@@ -84,13 +139,47 @@ static void perft(struct position *pos, int depth, uint32_t *nleafs)
         return;
     }
 
+    /*
+     * Since only legal moves are generated the leafs can be
+     * counted without making the moves.
+     */
+    gen_legal_moves(pos, &list);
+    if (depth == 1) {
+        (*nleafs) += list.size;
+        return;
+    }
+
+    /* Search all moves */
+    for (k=0;k<list.size;k++) {
+        board_make_legal_move(pos, list.moves[k]);
+        perft(pos, depth-1, nleafs);
+        board_unmake_move(pos);
+    }
+}
+
+/*
+ * Perft using the pseudo-legal move generator where illegal
+ * moves are detected by making them on the board.
+ */
+static void perft_pseudo_legal(struct position *pos, int depth,
+                               uint32_t *nleafs)
+{
+    struct movelist list;
+    int             k;
+
+    /* Check if its time to stop */
+    if (depth == 0) {
+        (*nleafs)++;
+        return;
+    }
+
     /* Search all moves */
     gen_moves(pos, &list);
     for (k=0;k<list.size;k++) {
         if (!board_make_move(pos, list.moves[k])) {
             continue;
         }
-        perft(pos, depth-1, nleafs);
+        perft_pseudo_legal(pos, depth-1, nleafs);
         board_unmake_move(pos);
     }
 }
@@ -125,11 +214,9 @@ void test_run_divide(struct position *pos, int depth)
     fen_build_string(pos, fenstr);
 
     ntotal = 0;
-    gen_moves(pos, &list);
+    gen_legal_moves(pos, &list);
     for (k=0;k<list.size;k++) {
-        if (!board_make_move(pos, list.moves[k])) {
-            continue;
-        }
+        board_make_legal_move(pos, list.moves[k]);
         nleafs = 0;
         perft(pos, depth-1, &nleafs);
         ntotal += nleafs;
@@ -142,12 +229,66 @@ void test_run_divide(struct position *pos, int depth)
     printf("Leafs: %u\n", ntotal);
 }
 
+bool test_run_perft_compare(void)
+{
+    struct position pos;
+    uint32_t        nleafs;
+    uint32_t        nleafs_pseudo;
+    time_t          start;
+    time_t          time_legal;
+    time_t          time_pseudo;
+    time_t          total_legal;
+    time_t          total_pseudo;
+    bool            ok;
+    int             npositions;
+    int             k;
+
+    ok = true;
+    total_legal = 0;
+    total_pseudo = 0;
+    npositions = sizeof(perft_positions)/sizeof(struct perft_position);
+    for (k=0;k<npositions;k++) {
+        board_setup_from_fen(&pos, perft_positions[k].fen);
+
+        nleafs_pseudo = 0;
+        start = get_current_time();
+        perft_pseudo_legal(&pos, perft_positions[k].depth, &nleafs_pseudo);
+        time_pseudo = get_current_time() - start;
+
+        nleafs = 0;
+        start = get_current_time();
+        perft(&pos, perft_positions[k].depth, &nleafs);
+        time_legal = get_current_time() - start;
+
+        printf("%d: depth %d, pseudo-legal %u (%.2fs), legal %u (%.2fs)%s\n",
+               k+1, perft_positions[k].depth, nleafs_pseudo,
+               time_pseudo/1000.0, nleafs, time_legal/1000.0,
+               ((nleafs == perft_positions[k].nleafs) &&
+                (nleafs_pseudo == perft_positions[k].nleafs))?"":
+                                                            " MISMATCH");
+        if ((nleafs != perft_positions[k].nleafs) ||
+            (nleafs_pseudo != perft_positions[k].nleafs)) {
+            ok = false;
+        }
+        total_legal += time_legal;
+        total_pseudo += time_pseudo;
+    }
+    printf("Pseudo-legal: %.2fs\n", total_pseudo/1000.0);
+    printf("Legal: %.2fs\n", total_legal/1000.0);
+
+    return ok;
+}
+
 void test_run_benchmark(void)
 {
     struct gamestate *state;
     int              k;
     int              npos;
     uint64_t         nodes;
+    uint64_t         pawn_probes;
+    uint64_t         pawn_hits;
+    uint64_t         probes;
+    uint64_t         hits;
     time_t           start;
     time_t           total;
 
@@ -158,6 +299,8 @@ void test_run_benchmark(void)
 
     state = create_game_state();
     nodes = 0ULL;
+    pawn_probes = 0ULL;
+    pawn_hits = 0ULL;
     total = 0;
     npos = sizeof(positions)/sizeof(char*);
     for (k=0;k<npos;k++) {
@@ -173,6 +316,9 @@ void test_run_benchmark(void)
         smp_search(state, false, false, false);
         total += (get_current_time() - start);
         nodes += smp_nodes();
+        smp_pawntt_statistics(&probes, &hits);
+        pawn_probes += probes;
+        pawn_hits += hits;
 
         printf("#");
     }
@@ -181,6 +327,275 @@ void test_run_benchmark(void)
     printf("Total time: %.2fs\n", total/1000.0);
     printf("Total number of nodes: %"PRIu64"\n", nodes);
     printf("Speed: %.2fkN/s\n", ((double)nodes)/(total/1000.0)/1000);
+    printf("Pawn hash hit rate: %.2f%%\n",
+           (pawn_probes > 0)?(100.0*pawn_hits)/pawn_probes:0.0);
+
+    destroy_game_state(state);
+}
+
+/*
+ * Get the key to use for a specific index in the transposition table
+ * test. The keys are restricted so that they all end up in the first
+ * few buckets of a table of the minimum size.
+ */
+static uint64_t tt_stress_key(int idx)
+{
+    uint64_t key;
+    uint64_t nbuckets;
+
+    key = (uint64_t)(idx + 1)*0x9E3779B97F4A7C15ULL;
+    key ^= key >> 31;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+
+    nbuckets = (MIN_MAIN_HASH_SIZE*1024ULL*1024ULL)/sizeof(struct tt_bucket);
+    return key%((UINT64_MAX/nbuckets)*TT_STRESS_NBUCKETS);
+}
+
+static thread_retval_t tt_stress_thread(void *data)
+{
+    struct tt_stress_data *td = data;
+    struct position       *pos = &td->pos;
+    struct tt_item        item;
+    uint64_t              key;
+    uint32_t              move;
+    int                   score;
+    int                   eval_score;
+    int                   depth;
+    int                   type;
+    int                   k;
+
+    for (k=0;k<TT_STRESS_ITERATIONS;k++) {
+        /* Select a key using a xorshift generator */
+        td->seed ^= td->seed << 13;
+        td->seed ^= td->seed >> 7;
+        td->seed ^= td->seed << 17;
+        key = tt_stress_key((int)(td->seed%TT_STRESS_NKEYS));
+
+        /*
+         * The stored data is derived from the key. The move goes to an
+         * empty square so that it is restored without a capture flag.
+         */
+        move = MOVE(key&0x3F, A3+(key>>6)%32, NO_PIECE, NORMAL);
+        score = (int)((key>>12)%2001) - 1000;
+        eval_score = (int)((key>>24)%2001) - 1000;
+        depth = (int)((key>>36)%MAX_SEARCH_DEPTH);
+        type = (int)((key>>44)%3);
+
+        pos->key = key;
+        if (((td->seed>>32)&1) != 0) {
+            hash_tt_store(pos, move, depth, score, type, eval_score);
+            continue;
+        }
+
+        /*
+         * Check that an entry that is found have exactly
+         * the data that was stored for the key.
+         */
+        td->nlookups++;
+        if (!hash_tt_lookup(pos, &item)) {
+            continue;
+        }
+        td->nhits++;
+        if ((item.move != move) || (item.score != score) ||
+            (item.eval_score != eval_score) || (item.depth != depth) ||
+            (item.type != type)) {
+            td->nerrors++;
+        }
+    }
+
+    return (thread_retval_t)0;
+}
+
+bool test_run_tt_stress(int nthreads)
+{
+    struct tt_stress_data *data;
+    uint64_t              nlookups;
+    uint64_t              nhits;
+    uint64_t              nerrors;
+    time_t                start;
+    int                   k;
+
+    assert(nthreads > 0);
+
+    data = calloc(nthreads, sizeof(struct tt_stress_data));
+    if (data == NULL) {
+        return false;
+    }
+
+    hash_tt_destroy_table();
+    hash_tt_create_table(MIN_MAIN_HASH_SIZE);
+
+    /* Start all threads */
+    start = get_current_time();
+    for (k=0;k<nthreads;k++) {
+        board_setup_from_fen(&data[k].pos, FEN_STARTPOS);
+        data[k].seed = 0x2545F4914F6CDD1DULL*(uint64_t)(k + 1);
+        thread_create(&data[k].thread, (thread_func_t)tt_stress_thread,
+                      &data[k]);
+    }
+
+    /* Wait for all threads to finish and collect the results */
+    nlookups = 0ULL;
+    nhits = 0ULL;
+    nerrors = 0ULL;
+    for (k=0;k<nthreads;k++) {
+        thread_join(&data[k].thread);
+        nlookups += data[k].nlookups;
+        nhits += data[k].nhits;
+        nerrors += data[k].nerrors;
+    }
+
+    printf("Threads: %d\n", nthreads);
+    printf("Time: %.2fs\n", (get_current_time() - start)/1000.0);
+    printf("Lookups: %"PRIu64"\n", nlookups);
+    printf("Hits: %"PRIu64"\n", nhits);
+    printf("Inconsistent entries: %"PRIu64"\n", nerrors);
+
+    free(data);
+
+    return nerrors == 0ULL;
+}
+
+void test_run_smp_latency(int nthreads)
+{
+    struct gamestate *state;
+    uint64_t         latency;
+    uint64_t         total;
+    uint64_t         worst;
+    int              k;
+
+    assert(nthreads > 0);
+
+    smp_destroy_workers();
+    smp_create_workers(nthreads);
+
+    state = create_game_state();
+    total = 0ULL;
+    worst = 0ULL;
+    for (k=0;k<LATENCY_NSEARCHES;k++) {
+        board_setup_from_fen(&state->pos, FEN_STARTPOS);
+        tc_configure_time_control(0, 0, 0, TC_INFINITE_TIME);
+        state->sd = LATENCY_DEPTH;
+        state->silent = true;
+        state->move_filter.size = 0;
+
+        smp_search(state, false, false, false);
+        latency = smp_start_latency();
+        total += latency;
+        worst = MAX(worst, latency);
+    }
+
+    printf("Threads: %d\n", nthreads);
+    printf("Searches: %d\n", LATENCY_NSEARCHES);
+    printf("Average start latency: %.1fus\n",
+           ((double)total)/LATENCY_NSEARCHES);
+    printf("Worst start latency: %"PRIu64"us\n", worst);
+
+    destroy_game_state(state);
+}
+
+void test_run_nps_scaling(int max_threads)
+{
+    struct gamestate *state;
+    uint64_t         nodes;
+    time_t           start;
+    time_t           total;
+    double           nps;
+    double           base_nps;
+    int              nthreads;
+    int              k;
+
+    assert(max_threads > 0);
+
+    state = create_game_state();
+    base_nps = 0.0;
+    printf("Threads         NPS  Speedup  Efficiency\n");
+    nthreads = 1;
+    while (true) {
+        smp_destroy_workers();
+        smp_create_workers(nthreads);
+
+        nodes = 0ULL;
+        total = 0;
+        for (k=0;k<SCALING_NPOSITIONS;k++) {
+            board_setup_from_fen(&state->pos, positions[k]);
+            tc_configure_time_control(SCALING_TIME, 0, 0,
+                                      TC_FIXED_TIME|TC_TIME_LIMIT);
+            hash_tt_clear_table();
+            smp_newgame();
+            state->sd = MAX_SEARCH_DEPTH;
+            state->silent = true;
+            state->move_filter.size = 0;
+            state->exit_on_mate = false;
+
+            start = get_current_time();
+            smp_search(state, false, false, false);
+            total += (get_current_time() - start);
+            nodes += smp_nodes();
+        }
+
+        nps = (total > 0)?((double)nodes)/(total/1000.0):0.0;
+        if (nthreads == 1) {
+            base_nps = (nps > 0.0)?nps:1.0;
+        }
+        printf("%7d %11.0f %8.2f %10.2f\n", nthreads, nps, nps/base_nps,
+               nps/base_nps/nthreads);
+
+        if (nthreads == max_threads) {
+            break;
+        }
+        nthreads = MIN(nthreads*2, max_threads);
+    }
+
+    destroy_game_state(state);
+}
+
+void test_run_time_to_depth(int nthreads)
+{
+    struct gamestate *state;
+    char             *modes[] = {"lazy", "abdada"};
+    uint64_t         nodes;
+    time_t           start;
+    time_t           total;
+    int              npos;
+    int              k;
+    int              l;
+
+    assert(nthreads > 0);
+
+    smp_destroy_workers();
+    smp_create_workers(nthreads);
+
+    state = create_game_state();
+    npos = sizeof(positions)/sizeof(char*);
+    printf("Threads: %d\n", nthreads);
+    printf("Depth: %d\n", TTD_DEPTH);
+    for (l=0;l<(int)(sizeof(modes)/sizeof(char*));l++) {
+        (void)smp_set_mode(modes[l]);
+
+        nodes = 0ULL;
+        total = 0;
+        for (k=0;k<npos;k++) {
+            board_setup_from_fen(&state->pos, positions[k]);
+            tc_configure_time_control(0, 0, 0, TC_INFINITE_TIME);
+            hash_tt_clear_table();
+            smp_newgame();
+            state->sd = TTD_DEPTH;
+            state->silent = true;
+            state->move_filter.size = 0;
+            state->exit_on_mate = true;
+
+            start = get_current_time();
+            smp_search(state, false, false, false);
+            total += (get_current_time() - start);
+            nodes += smp_nodes();
+        }
+
+        printf("%-6s time %.2fs nodes %"PRIu64"\n", modes[l], total/1000.0,
+               nodes);
+    }
+    (void)smp_set_mode(engine_default_smp_mode);
 
     destroy_game_state(state);
 }
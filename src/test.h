@@ -46,7 +46,53 @@ void test_run_perft(struct position *pos, int depth);
  */
 void test_run_divide(struct position *pos, int depth);
 
+/*
+ * Run perft on a number of positions with known results, once with the
+ * pseudo-legal move generator and once with the legal move generator.
+ * The results and the time used by each generator are reported.
+ *
+ * @return Returns true if both generators give the correct results.
+ */
+bool test_run_perft_compare(void);
+
 /* Run a benchmark to check evaluate the performance of the engine */
 void test_run_benchmark(void);
 
+/*
+ * Run a stress test of the main transposition table. A number of threads
+ * store and lookup entries concurrently in a small part of the table and
+ * checks that every entry that is found is consistent with its key.
+ *
+ * @param nthreads The number of threads to use.
+ * @return Returns true if no inconsistent entries were found.
+ */
+bool test_run_tt_stress(int nthreads);
+
+/*
+ * Measure the time it takes from the start of a search until all
+ * workers have started searching. A number of short searches are run
+ * and the average and worst latency are reported.
+ *
+ * @param nthreads The number of threads to use.
+ */
+void test_run_smp_latency(int nthreads);
+
+/*
+ * Measure how the search speed scales with the number of threads. A
+ * number of positions are searched for a fixed time using 1, 2, 4, ...
+ * threads up to the maximum and the speedup compared to a single
+ * thread is reported.
+ *
+ * @param max_threads The maximum number of threads to use.
+ */
+void test_run_nps_scaling(int max_threads);
+
+/*
+ * Measure the time needed to search a number of positions to a fixed
+ * depth, once with Lazy SMP and once with ABDADA.
+ *
+ * @param nthreads The number of threads to use.
+ */
+void test_run_time_to_depth(int nthreads);
+
 #endif
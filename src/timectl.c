@@ -174,7 +174,7 @@ bool tc_check_time(struct search_worker *worker)
     if ((worker->resolving_root_fail || worker->resolving_tt_fail) &&
         (worker->depth > worker->state->completed_depth)) {
         return get_current_time() < hard_time_limit;
-    } else if ((worker->currmovenumber == 1) &&
+    } else if ((worker->stats.currmovenumber == 1) &&
                (worker->depth > worker->state->completed_depth)) {
         return get_current_time() < medium_time_limit;
     } else {
@@ -36,15 +36,41 @@
 #include "validation.h"
 #include "tbprobe.h"
 #include "smp.h"
+#include "cluster.h"
 
 /* Different UCI modes */
 static bool ponder_mode = false;
 static bool own_book_mode = true;
 static bool tablebase_mode = false;
 
+/* Configuration of the pawn transposition tables */
+static int pawn_hash_size = PAWN_HASH_SIZE;
+static bool shared_pawn_hash = false;
+
+/* Configuration of CPU pinning */
+static char cpu_affinity[MAX_CPU_AFFINITY_LENGTH+1] = "none";
+static bool avoid_smt = true;
+
 /* Helper variable used for sorting pv lines */
 static struct pvinfo sorted_mpv_lines[MAX_MULTIPV_LINES];
 
+/* Search statistics collected at the end of a search */
+static uint64_t search_stats[MAX_SEARCH_DEPTH][NSEARCHSTATS];
+
+/* Description of the different kinds of memory backing */
+static char *memory_backing_names[] = {
+    "normal pages",
+    "transparent huge pages",
+    "2MB huge pages",
+    "1GB huge pages"
+};
+
+static void send_hash_info(void)
+{
+    engine_write_command("info string Hash table allocated using %s",
+                         memory_backing_names[hash_tt_memory_backing()]);
+}
+
 static void uci_cmd_go(char *cmd, struct gamestate *state)
 {
     char     *iter;
@@ -307,7 +333,40 @@ static void uci_cmd_setoption(char *cmd, struct gamestate *state)
         iter += 4;
         iter = skip_whitespace(iter);
 
-        if (!strncmp(iter, "Hash", 4)) {
+        if (!strncmp(iter, "HashFile", 8)) {
+            iter = strstr(iter, "value");
+            iter += strlen("value");
+            iter = skip_whitespace(iter);
+
+            if (!strncmp(iter, "<empty>", 7)) {
+                engine_hash_file[0] = '\0';
+            } else {
+                strncpy(engine_hash_file, iter, MAX_PATH_LENGTH);
+            }
+        } else if (!strncmp(iter, "Save Hash", 9)) {
+            if (engine_hash_file[0] == '\0') {
+                engine_write_command("info string No hash file specified");
+            } else if (hash_tt_save(engine_hash_file)) {
+                engine_write_command("info string Hash table saved to %s",
+                                     engine_hash_file);
+            } else {
+                engine_write_command(
+                                "info string Failed to save hash table to %s",
+                                engine_hash_file);
+            }
+        } else if (!strncmp(iter, "Load Hash", 9)) {
+            if (engine_hash_file[0] == '\0') {
+                engine_write_command("info string No hash file specified");
+            } else if (hash_tt_load(engine_hash_file)) {
+                engine_write_command("info string Hash table loaded from %s",
+                                     engine_hash_file);
+                send_hash_info();
+            } else {
+                engine_write_command(
+                                "info string Failed to load hash table from %s",
+                                engine_hash_file);
+            }
+        } else if (!strncmp(iter, "Hash", 4)) {
             iter += 4;
             iter = skip_whitespace(iter);
             if (sscanf(iter, "value %d", &value) == 1) {
@@ -317,9 +376,42 @@ static void uci_cmd_setoption(char *cmd, struct gamestate *state)
                     value = MIN_MAIN_HASH_SIZE;
                 }
                 hash_tt_create_table(value);
+                send_hash_info();
+            }
+        } else if (!strncmp(iter, "PawnHash", 8)) {
+            iter += 8;
+            iter = skip_whitespace(iter);
+            if (sscanf(iter, "value %d", &value) == 1) {
+                if (value > MAX_PAWN_HASH_SIZE) {
+                    value = MAX_PAWN_HASH_SIZE;
+                } else if (value < MIN_PAWN_HASH_SIZE) {
+                    value = MIN_PAWN_HASH_SIZE;
+                }
+                pawn_hash_size = value;
+                smp_set_pawn_hash(pawn_hash_size, shared_pawn_hash);
             }
+        } else if (!strncmp(iter, "SharedPawnHash", 14)) {
+            iter = strstr(iter, "value");
+            iter += strlen("value");
+            iter = skip_whitespace(iter);
+            if (!strncmp(iter, "false", 5)) {
+                shared_pawn_hash = false;
+            } else if (!strncmp(iter, "true", 4)) {
+                shared_pawn_hash = true;
+            }
+            smp_set_pawn_hash(pawn_hash_size, shared_pawn_hash);
         } else if (!strncmp(iter, "Clear Hash", 10)) {
             hash_tt_clear_table();
+        } else if (!strncmp(iter, "LargePages", 10)) {
+            iter = strstr(iter, "value");
+            iter += strlen("value");
+            iter = skip_whitespace(iter);
+            if (!strncmp(iter, "false", 5)) {
+                hash_tt_set_large_pages(false);
+            } else if (!strncmp(iter, "true", 4)) {
+                hash_tt_set_large_pages(true);
+            }
+            send_hash_info();
         } else if (!strncmp(iter, "OwnBook", 7)) {
             iter = strstr(iter, "value");
             iter += strlen("value");
@@ -358,6 +450,64 @@ static void uci_cmd_setoption(char *cmd, struct gamestate *state)
                 smp_destroy_workers();
                 smp_create_workers(value);
             }
+        } else if (!strncmp(iter, "NumaBind", 8)) {
+            iter = strstr(iter, "value");
+            iter += strlen("value");
+            iter = skip_whitespace(iter);
+            if (!strncmp(iter, "false", 5)) {
+                smp_set_numa_binding(false);
+            } else if (!strncmp(iter, "true", 4)) {
+                smp_set_numa_binding(true);
+            }
+        } else if (!strncmp(iter, "CpuAffinity", 11)) {
+            iter = strstr(iter, "value");
+            iter += strlen("value");
+            iter = skip_whitespace(iter);
+            if (smp_set_cpu_affinity(iter, avoid_smt)) {
+                strncpy(cpu_affinity, iter, MAX_CPU_AFFINITY_LENGTH);
+            } else {
+                engine_write_command("info string Invalid CPU affinity %s",
+                                     iter);
+            }
+        } else if (!strncmp(iter, "AvoidSMT", 8)) {
+            iter = strstr(iter, "value");
+            iter += strlen("value");
+            iter = skip_whitespace(iter);
+            if (!strncmp(iter, "false", 5)) {
+                avoid_smt = false;
+            } else if (!strncmp(iter, "true", 4)) {
+                avoid_smt = true;
+            }
+            (void)smp_set_cpu_affinity(cpu_affinity, avoid_smt);
+        } else if (!strncmp(iter, "SmpDepthPattern", 15)) {
+            iter = strstr(iter, "value");
+            iter += strlen("value");
+            iter = skip_whitespace(iter);
+            (void)smp_set_depth_pattern(iter);
+        } else if (!strncmp(iter, "ClusterNodes", 12)) {
+            iter += 12;
+            iter = skip_whitespace(iter);
+            if (sscanf(iter, "value %d", &value) == 1) {
+                value = CLAMP(value, 1, MAX_CLUSTER_NODES);
+                if (!cluster_start_nodes(value)) {
+                    engine_write_command(
+                                "info string Failed to start cluster nodes");
+                }
+            }
+        } else if (!strncmp(iter, "SmpMode", 7)) {
+            iter = strstr(iter, "value");
+            iter += strlen("value");
+            iter = skip_whitespace(iter);
+            (void)smp_set_mode(iter);
+        } else if (!strncmp(iter, "ParallelMultiPV", 15)) {
+            iter = strstr(iter, "value");
+            iter += strlen("value");
+            iter = skip_whitespace(iter);
+            if (!strncmp(iter, "false", 5)) {
+                smp_set_parallel_multipv(false);
+            } else if (!strncmp(iter, "true", 4)) {
+                smp_set_parallel_multipv(true);
+            }
         } else if (!strncmp(iter, "LogLevel", 8)) {
             iter += 8;
             iter = skip_whitespace(iter);
@@ -390,6 +540,10 @@ static void uci_cmd_uci(struct gamestate *state)
     engine_protocol = PROTOCOL_UCI;
 
     tablebase_mode = TB_LARGEST > 0;
+    pawn_hash_size = engine_default_pawn_hash_size;
+    shared_pawn_hash = engine_default_shared_pawn_hash;
+    strcpy(cpu_affinity, engine_default_cpu_affinity);
+    avoid_smt = engine_default_avoid_smt;
 
     state->silent = false;
 
@@ -399,6 +553,19 @@ static void uci_cmd_uci(struct gamestate *state)
                          engine_default_hash_size, MIN_MAIN_HASH_SIZE,
 						 hash_tt_max_size());
     engine_write_command("option name Clear Hash type button");
+    engine_write_command(
+                    "option name PawnHash type spin default %d min %d max %d",
+                    engine_default_pawn_hash_size, MIN_PAWN_HASH_SIZE,
+                    MAX_PAWN_HASH_SIZE);
+    engine_write_command("option name SharedPawnHash type check default %s",
+                         engine_default_shared_pawn_hash?"true":"false");
+    engine_write_command("option name HashFile type string default %s",
+                         engine_hash_file[0] != '\0'?
+                                                engine_hash_file:"<empty>");
+    engine_write_command("option name Save Hash type button");
+    engine_write_command("option name Load Hash type button");
+    engine_write_command("option name LargePages type check default %s",
+                         engine_default_large_pages?"true":"false");
     engine_write_command("option name OwnBook type check default true");
     engine_write_command("option name Ponder type check default false");
     engine_write_command("option name SyzygyPath type string default %s",
@@ -407,13 +574,30 @@ static void uci_cmd_uci(struct gamestate *state)
     engine_write_command(
                         "option name Threads type spin default %d min 1 max %d",
                         engine_default_num_threads, MAX_WORKERS);
+    engine_write_command("option name NumaBind type check default %s",
+                         engine_default_numa_bind?"true":"false");
+    engine_write_command("option name CpuAffinity type string default %s",
+                         engine_default_cpu_affinity);
+    engine_write_command("option name AvoidSMT type check default %s",
+                         engine_default_avoid_smt?"true":"false");
+    engine_write_command("option name SmpDepthPattern type combo default %s "
+                         "var half var skip var none",
+                         engine_default_depth_pattern);
+    engine_write_command("option name SmpMode type combo default %s "
+                         "var lazy var abdada", engine_default_smp_mode);
+    engine_write_command(
+                    "option name ClusterNodes type spin default %d min 1 max %d",
+                    engine_default_cluster_nodes, MAX_CLUSTER_NODES);
     engine_write_command(
                         "option name MultiPV type spin default 1 min 1 max %d",
                         MAX_MULTIPV_LINES);
+    engine_write_command("option name ParallelMultiPV type check default %s",
+                         engine_default_parallel_multipv?"true":"false");
     engine_write_command(
                        "option name LogLevel type spin default %d min 0 max %d",
                         dbg_get_log_level(), LOG_HIGHEST_LEVEL);
     engine_write_command("uciok");
+    send_hash_info();
 }
 
 static void uci_cmd_ucinewgame(void)
@@ -571,9 +755,10 @@ void uci_send_move_info(struct search_worker *worker)
     }
 
     /* Send command */
-    move2str(worker->currmove, movestr);
+    move2str(worker->stats.currmove, movestr);
     engine_write_command("info depth %d currmove %s currmovenumber %d",
-                         worker->depth, movestr, worker->currmovenumber);
+                         worker->depth, movestr,
+                         worker->stats.currmovenumber);
 }
 
 void uci_send_multipv_info(struct search_worker *worker)
@@ -631,3 +816,65 @@ void uci_send_multipv_info(struct search_worker *worker)
         engine_write_command(buffer);
     }
 }
+
+void uci_send_selection_info(struct search_worker *worker, int64_t votes,
+                             int64_t total, char *reason)
+{
+    char movestr[MAX_MOVESTR_LENGTH];
+
+    move2str(worker->mpv_moves[0], movestr);
+    engine_write_command("info string thread %d selected (%s) move %s "
+                         "depth %d score %d votes %"PRId64"/%"PRId64,
+                         worker->id, reason, movestr,
+                         worker->mpv_lines[0].depth,
+                         worker->mpv_lines[0].score, votes, total);
+}
+
+/* Percentage of a counter relative to another, with one decimal */
+static double stats_percent(uint64_t count, uint64_t total)
+{
+    return (total > 0)?(100.0*count)/total:0.0;
+}
+
+void uci_send_search_stats(void)
+{
+    uint64_t total[NSEARCHSTATS];
+    int      depth;
+    int      k;
+
+    if (!smp_search_statistics(search_stats)) {
+        return;
+    }
+    for (k=0;k<NSEARCHSTATS;k++) {
+        total[k] = 0ULL;
+        for (depth=0;depth<MAX_SEARCH_DEPTH;depth++) {
+            total[k] += search_stats[depth][k];
+        }
+    }
+
+    engine_write_command("info string stats nodes %"PRIu64" tthit %.1f%% "
+        "ttcut %.1f%% rfp %"PRIu64" razor %.1f%%/%"PRIu64" "
+        "null %.1f%%/%"PRIu64" probcut %.1f%%/%"PRIu64,
+        total[SSTAT_NODES],
+        stats_percent(total[SSTAT_TT_HITS], total[SSTAT_TT_PROBES]),
+        stats_percent(total[SSTAT_TT_CUTOFFS], total[SSTAT_TT_PROBES]),
+        total[SSTAT_RFP_PRUNES],
+        stats_percent(total[SSTAT_RAZOR_CUTOFFS], total[SSTAT_RAZOR_TRIES]),
+        total[SSTAT_RAZOR_TRIES],
+        stats_percent(total[SSTAT_NULL_CUTOFFS], total[SSTAT_NULL_TRIES]),
+        total[SSTAT_NULL_TRIES],
+        stats_percent(total[SSTAT_PROBCUT_CUTOFFS],
+                      total[SSTAT_PROBCUT_TRIES]),
+        total[SSTAT_PROBCUT_TRIES]);
+    engine_write_command("info string stats futility %"PRIu64" "
+        "lmp %"PRIu64" see %"PRIu64" history %"PRIu64" "
+        "lmr %.1f%%/%"PRIu64" singular %.1f%%/%"PRIu64" fh1 %.1f%%",
+        total[SSTAT_FUTILITY_PRUNES], total[SSTAT_LMP_PRUNES],
+        total[SSTAT_SEE_PRUNES], total[SSTAT_HISTORY_PRUNES],
+        stats_percent(total[SSTAT_LMR_RESEARCHES], total[SSTAT_LMR_SEARCHES]),
+        total[SSTAT_LMR_SEARCHES],
+        stats_percent(total[SSTAT_SE_EXTENSIONS], total[SSTAT_SE_TRIES]),
+        total[SSTAT_SE_TRIES],
+        stats_percent(total[SSTAT_FIRST_MOVE_FAIL_HIGHS],
+                      total[SSTAT_FAIL_HIGHS]));
+}
@@ -71,4 +71,19 @@ void uci_send_move_info(struct search_worker *worker);
  */
 void uci_send_multipv_info(struct search_worker *worker);
 
+/*
+ * Send information about which worker that was selected to provide
+ * the best move.
+ *
+ * @param worker The selected worker.
+ * @param votes The number of votes for the selected move.
+ * @param total The total number of votes.
+ * @param reason The reason the worker was selected.
+ */
+void uci_send_selection_info(struct search_worker *worker, int64_t votes,
+                             int64_t total, char *reason);
+
+/* Send a summary of the search statistics */
+void uci_send_search_stats(void);
+
 #endif
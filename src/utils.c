@@ -29,6 +29,10 @@
 #include <time.h>
 #include <unistd.h>
 #endif
+#ifdef __linux__
+#include <sys/mman.h>
+#include <stdio.h>
+#endif
 
 #include "utils.h"
 #include "thread.h"
@@ -172,6 +176,25 @@ time_t get_current_time(void)
 #endif
 }
 
+uint64_t get_current_time_us(void)
+{
+#ifdef WINDOWS
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((counter.QuadPart/frequency.QuadPart)*1000000 +
+                ((counter.QuadPart%frequency.QuadPart)*1000000)/
+                                                        frequency.QuadPart);
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return ((uint64_t)tv.tv_sec)*1000000ULL + (uint64_t)tv.tv_usec;
+#endif
+}
+
 int get_current_pid(void)
 {
 #ifdef WINDOWS
@@ -327,6 +350,116 @@ void aligned_free(void *ptr)
 #endif
 }
 
+#ifdef __linux__
+static uint64_t round_up(uint64_t size, uint64_t alignment)
+{
+    return ((size+alignment-1)/alignment)*alignment;
+}
+
+static void* mmap_huge_pages(uint64_t size, int flags)
+{
+    void *ptr;
+
+    ptr = mmap(NULL, size, PROT_READ|PROT_WRITE,
+               MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB|flags, -1, 0);
+    return (ptr == MAP_FAILED)?NULL:ptr;
+}
+
+/*
+ * Transparent huge pages can only be requested with madvise if the
+ * kernel is configured for it, which is not the case when the mode
+ * is set to never.
+ */
+static bool transparent_huge_pages_enabled(void)
+{
+    FILE *fp;
+    char buffer[128];
+    bool enabled;
+
+    fp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (fp == NULL) {
+        return false;
+    }
+    enabled = (fgets(buffer, sizeof(buffer), fp) != NULL) &&
+              (strstr(buffer, "[never]") == NULL);
+    fclose(fp);
+
+    return enabled;
+}
+#endif
+
+void* large_pages_malloc(uint64_t size, int *backing)
+{
+#ifdef __linux__
+    void *ptr;
+
+    assert(backing != NULL);
+
+#if defined(MAP_HUGE_SHIFT)
+    /* Try 1GB pages when the allocation is big enough to fill one */
+    if (size >= (uint64_t)512*HUGE_PAGE_SIZE) {
+        ptr = mmap_huge_pages(round_up(size, (uint64_t)512*HUGE_PAGE_SIZE),
+                              30<<MAP_HUGE_SHIFT);
+        if (ptr != NULL) {
+            *backing = MEMORY_HUGE_PAGES_1GB;
+            return ptr;
+        }
+    }
+#endif
+
+    /* Try explicit huge pages of the default size */
+    ptr = mmap_huge_pages(round_up(size, HUGE_PAGE_SIZE), 0);
+    if (ptr != NULL) {
+        *backing = MEMORY_HUGE_PAGES_2MB;
+        return ptr;
+    }
+
+    /*
+     * Ask for transparent huge pages. The memory is aligned to the
+     * huge page size to allow the kernel to back all of it with huge
+     * pages.
+     */
+    if ((size >= HUGE_PAGE_SIZE) && transparent_huge_pages_enabled()) {
+        ptr = aligned_malloc(HUGE_PAGE_SIZE, round_up(size, HUGE_PAGE_SIZE));
+        if (ptr != NULL) {
+            if (madvise(ptr, round_up(size, HUGE_PAGE_SIZE),
+                        MADV_HUGEPAGE) == 0) {
+                *backing = MEMORY_TRANSPARENT_HUGE_PAGES;
+                return ptr;
+            }
+            aligned_free(ptr);
+        }
+    }
+#endif
+
+    *backing = MEMORY_NORMAL_PAGES;
+    return aligned_malloc(CACHE_LINE_SIZE, size);
+}
+
+void large_pages_free(void *ptr, uint64_t size, int backing)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    switch (backing) {
+#ifdef __linux__
+    case MEMORY_HUGE_PAGES_1GB:
+        (void)munmap(ptr, round_up(size, (uint64_t)512*HUGE_PAGE_SIZE));
+        break;
+    case MEMORY_HUGE_PAGES_2MB:
+        (void)munmap(ptr, round_up(size, HUGE_PAGE_SIZE));
+        break;
+#endif
+    case MEMORY_TRANSPARENT_HUGE_PAGES:
+    case MEMORY_NORMAL_PAGES:
+    default:
+        (void)size;
+        aligned_free(ptr);
+        break;
+    }
+}
+
 void parallel_memset(void *memory, uint8_t value, size_t size, int nthreads)
 {
     int k;
@@ -30,6 +30,17 @@
 /* The cache line size */
 #define CACHE_LINE_SIZE 64
 
+/* The size of a huge memory page */
+#define HUGE_PAGE_SIZE (2*1024*1024)
+
+/* Different kinds of memory backing for large allocations */
+enum {
+    MEMORY_NORMAL_PAGES,
+    MEMORY_TRANSPARENT_HUGE_PAGES,
+    MEMORY_HUGE_PAGES_2MB,
+    MEMORY_HUGE_PAGES_1GB
+};
+
 /* Macro for prefetching the data at an address in to the cache */
 #ifdef __GNUC__
 #define PREFETCH_ADDRESS(a) __builtin_prefetch((a))
@@ -78,6 +89,13 @@ int pop_bit(uint64_t *v);
  */
 time_t get_current_time(void);
 
+/*
+ * Get the current time with microsecond resolution.
+ *
+ * @return Returns the current time in microseconds.
+ */
+uint64_t get_current_time_us(void);
+
 /*
  * Get the PID of the calling process.
  *
@@ -147,6 +165,27 @@ void* aligned_malloc(int alignment, uint64_t size);
  */
 void aligned_free(void *ptr);
 
+/*
+ * Allocate a large block of memory, backed by huge pages if the
+ * operating system allows it. Explicit huge pages are tried first,
+ * followed by transparent huge pages. If neither is available then
+ * the memory is allocated with aligned_malloc.
+ *
+ * @param size The amount of memory to allocate.
+ * @param backing Location to store the kind of memory backing at.
+ * @return Returns a pointer to the allocated memory.
+ */
+void* large_pages_malloc(uint64_t size, int *backing);
+
+/*
+ * Free memory allocated with large_pages_malloc.
+ *
+ * @param ptr Pointer to the memory to free.
+ * @param size The size that was requested when allocating the memory.
+ * @param backing The kind of memory backing used for the memory.
+ */
+void large_pages_free(void *ptr, uint64_t size, int backing);
+
 /*
  * Parallel version of memset.
  *